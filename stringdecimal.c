@@ -34,6 +34,13 @@
 #include <err.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
+#ifdef	__SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 char sd_comma = ',';
 char sd_point = '.';
@@ -141,6 +148,7 @@ struct
 #define	FRACTIONS (sizeof (fraction)/sizeof(*fraction))
 
 //#define DEBUG
+//#define NOFREELIST              // No free lists, so leak checkers see every allocation
 
 // Support functions
 
@@ -152,6 +160,7 @@ struct sd_val_s
    int max;                     // Max space at m
    char *d;                     // Digit array (normally m, or advanced in to m), digits 0-9 not characters '0'-'9'
    char neg:1;                  // Sign (set if -1)
+   char inarena:1;              // From an arena, freed with it
    char m[];                    // Malloced space
 };
 
@@ -161,10 +170,6 @@ static sd_val_t one = { 0, 1, 1, (char[])
    {1}
 };
 
-static sd_val_t two = { 0, 1, 1, (char[])
-   {2}
-};
-
 //static sd_val_t two = { 0, 1, (char[]) { 2 } };
 
 struct sd_s
@@ -172,6 +177,10 @@ struct sd_s
    sd_val_t *n;                 // Numerator
    sd_val_t *d;                 // Denominator
    int places;                  // Max places seen
+   int prec;                    // Max significant digits, 0 for exact
+   int precden;                 // Max denominator digits before making decimal, 0 for same as prec
+   sd_round_t precround;        // Rounding when over prec/precden
+   unsigned char inarena:1;     // From an arena, freed with it
    const char *failure;         // Error message
 };
 
@@ -190,8 +199,202 @@ comp (const char *a, const char *b)
 
 static void sd_rational (sd_p p);
 
-// Safe free and NULL value
-#define freez(x)	do{if(x)free((void*)(x));x=NULL;}while(0)
+// Arena, see sd_arena
+typedef struct sd_arena_block_s sd_arena_block_t;
+struct sd_arena_block_s
+{
+   sd_arena_block_t *next;      // Older block
+   char *free;                  // Next free space
+   char *end;                   // End of block
+};
+struct sd_arena_s
+{
+   sd_arena_t *was;             // Arena installed before this one
+   sd_arena_block_t *block;     // Blocks, newest first
+};
+static __thread sd_arena_t *arena;     // Installed arena
+#define	ARENA_BLOCK	65536   // Arena block size
+#define	ARENA_LARGE	4096    // Bigger allocations are not from the arena, so big numbers are still freed as they go
+
+static inline int
+fromarena (size_t size)
+{                               // If salloc would use the installed arena, so the allocation can be tagged and not freed
+   return arena && size <= ARENA_LARGE;
+}
+
+static void *
+salloc (size_t size)
+{                               // Zeroed allocation, from the installed arena if small
+   if (!fromarena (size))
+      return calloc (1, size);
+   size = (size + 15) & ~15;
+   sd_arena_block_t *b = arena->block;
+   if (!b || b->free + size > b->end)
+   {
+      b = malloc (ARENA_BLOCK);
+      if (!b)
+         return b;
+      b->next = arena->block;
+      b->free = (char *) b + ((sizeof (*b) + 15) & ~15);
+      b->end = (char *) b + ARENA_BLOCK;
+      arena->block = b;
+   }
+   void *p = b->free;
+   b->free += size;
+   return memset (p, 0, size);
+}
+
+sd_arena_t *
+sd_arena (void)
+{                               // New arena, installed for this thread
+   sd_arena_t *a = calloc (1, sizeof (*a));
+   if (!a)
+      return a;                 // Values just come from the heap
+   a->was = arena;
+   arena = a;
+   return a;
+}
+
+void *
+sd_arena_end (sd_arena_t * a)
+{                               // Free arena and all allocated from it, putting back the arena installed before it
+   if (!a)
+      return a;
+   if (arena == a)
+      arena = a->was;
+   else
+      for (sd_arena_t * i = arena; i; i = i->was)
+         if (i->was == a)
+         {                      // Not innermost, so unlink from the one installed after it
+            i->was = a->was;
+            break;
+         }
+   while (a->block)
+   {
+      sd_arena_block_t *b = a->block;
+      a->block = b->next;
+      free (b);
+   }
+   free (a);
+   return NULL;
+}
+
+// Per thread free lists of values, by size, and of sd_p, so allocation is mostly off the heap
+#define	FREELIST_CLASSES	7       // Value sizes 32 bytes doubling to 2k
+#define	FREELIST_MAX	64      // Max held in each list
+typedef struct freelist_s freelist_t;
+struct freelist_s
+{
+   void *head;                  // Free blocks, chained through their first pointer
+   int count;                   // Number held
+};
+static __thread freelist_t freeval[FREELIST_CLASSES],
+  freesd;
+
+static int
+freeclass (size_t size)
+{                               // Class that fits size, or -1 if too big
+   int c = 0;
+   while (c < FREELIST_CLASSES && (32 << c) < size)
+      c++;
+   return c < FREELIST_CLASSES ? c : -1;
+}
+
+static void *
+flpop (freelist_t * f, size_t size)
+{                               // Zeroed block from list, or NULL
+#ifdef	NOFREELIST
+   return NULL;
+#else
+   void **b = f->head;
+   if (!b)
+      return b;
+   f->head = *b;
+   f->count--;
+   return memset (b, 0, size);
+#endif
+}
+
+static int
+flpush (freelist_t * f, void *p)
+{                               // Add block to list, 0 if full
+#ifdef	NOFREELIST
+   return 0;
+#else
+   if (f->count >= FREELIST_MAX)
+      return 0;
+   *(void **) p = f->head;
+   f->head = p;
+   f->count++;
+   return 1;
+#endif
+}
+
+static sd_val_t *
+vmake (int max)
+{                               // Zeroed value with space for at least max digits, max set to the space
+   sd_val_t *v = NULL;
+   size_t size = sizeof (*v) + max;
+   int c = (arena ? -1 : freeclass (size));
+   if (c >= 0)
+   {                            // Whole size class, so it can go back on the list
+      size = 32 << c;
+      v = flpop (&freeval[c], size);
+   }
+   if (!v)
+      v = salloc (size);
+   if (v)
+   {
+      v->max = size - sizeof (*v);
+      v->d = v->m;
+      v->inarena = fromarena (size);
+   }
+   return v;
+}
+
+static void
+vfree (void *p)
+{                               // Free value
+   sd_val_t *v = p;
+   if (v->inarena)
+      return;
+   int c = freeclass (sizeof (*v) + v->max);
+   if (c < 0 || (32 << c) != sizeof (*v) + v->max || !flpush (&freeval[c], v))
+      free (v);
+}
+
+static sd_p
+palloc (void)
+{                               // Zeroed sd_p
+   sd_p p = NULL;
+   if (!arena)
+      p = flpop (&freesd, sizeof (*p));
+   if (!p && (p = salloc (sizeof (*p))))
+      p->inarena = fromarena (sizeof (*p));
+   return p;
+}
+
+static void
+pfree (void *p)
+{                               // Free sd_p
+   if (!((sd_p) p)->inarena && !flpush (&freesd, p))
+      free (p);
+}
+
+static void
+fltrim (freelist_t * f)
+{                               // Empty list
+   while (f->head)
+   {
+      void **b = f->head;
+      f->head = *b;
+      free (b);
+   }
+   f->count = 0;
+}
+
+// Safe free and NULL value, values and sd_p go back on the free lists
+#define freez(x)	do{if(x)_Generic((x),sd_val_t*:vfree,sd_p:pfree,default:free)((void*)(x));x=NULL;}while(0)
 
 static int
 checkmax (const char **failp, int mag, int sig)
@@ -223,7 +426,7 @@ make (const char **failp, int mag, int sig)
       mag = 0;
    if (checkmax (failp, mag, sig))
       return NULL;
-   sd_val_t *v = calloc (1, sizeof (*v) + sig);
+   sd_val_t *v = vmake (sig);
    if (!v)
    {
       if (failp && !*failp)
@@ -235,8 +438,6 @@ make (const char **failp, int mag, int sig)
    }
    v->mag = mag;
    v->sig = sig;
-   v->max = sig;
-   v->d = v->m;
    return v;
 }
 
@@ -254,6 +455,335 @@ copy (const char **failp, sd_val_t * a)
    return r;
 }
 
+static sd_val_t *
+grow (const char **failp, sd_val_t * a, int mag, int end, int keep)
+{                               // Make a span positions mag down to end+1 in place, keeping its digits if keep (span must cover them), reallocating with headroom either side if it does not fit
+   int sig = mag - end;
+   if (checkmax (failp, mag, sig))
+      return NULL;
+   if ((keep && a->sig) ? (a->mag + (a->d - a->m) < mag || a->mag + (a->d - a->m) - a->max > end) : a->max < sig)
+   {                            // Reallocate, at least doubling
+      int max = a->max * 2;
+      if (max < sig + 16)
+         max = sig + 16;
+      sd_val_t *n = vmake (max);
+      if (!n)
+      {
+         if (failp && !*failp)
+            *failp = "Malloc failed";
+         return n;
+      }
+      max = n->max;
+      char inarena = n->inarena;
+      *n = *a;
+      n->max = max;
+      n->inarena = inarena;
+      n->d = n->m + (max - sig) / 2;
+      memset (n->d, 0, sig);
+      if (keep && a->sig)
+         memcpy (n->d + mag - a->mag, a->d, a->sig);
+      freez (a);
+      a = n;
+   } else if (keep && a->sig)
+   {                            // Zero either side of existing digits
+      char *d = a->d - (mag - a->mag);
+      memset (d, 0, a->d - d);
+      memset (a->d + a->sig, 0, sig - (a->d - d) - a->sig);
+      a->d = d;
+   } else
+   {
+      a->d = a->m + (a->max - sig) / 2;
+      if (keep)
+         memset (a->d, 0, sig);
+   }
+   a->mag = mag;
+   a->sig = sig;
+   return a;
+}
+
+// Digit kernels, on runs of digits most significant first, working a word at a time where possible
+
+static inline uint64_t
+dload (const char *p)
+{                               // 8 digits as a word, first digit most significant
+   uint64_t w;
+   memcpy (&w, p, sizeof (w));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   w = __builtin_bswap64 (w);
+#endif
+   return w;
+}
+
+static inline void
+dstore (char *p, uint64_t w)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   w = __builtin_bswap64 (w);
+#endif
+   memcpy (p, &w, sizeof (w));
+}
+
+#define	DLANES	0x0101010101010101ULL   // Low bit of each digit lane
+
+static int
+dadd (char *r, const char *b, int n)
+{                               // r += b, n digits, returns carry out
+   int c = 0;
+   while (n >= 8)
+   {                            // Adding 246 to each lane makes a digit sum of 10 or more carry in to the next lane as a normal add
+      n -= 8;
+      uint64_t x = dload (r + n) + dload (b + n),
+         k = DLANES * 246 + c,
+         s = x + k;
+      uint64_t carry = ((s ^ x ^ k) >> 8) & DLANES;     // Lanes that carried out, below the top lane
+      c = (s < x);
+      carry |= (uint64_t) c << 56;
+      dstore (r + n, s - ((~carry & DLANES) * 246));
+   }
+   while (n--)
+   {
+      int v = r[n] + b[n] + c;
+      c = (v >= 10);
+      r[n] = v - 10 * c;
+   }
+   return c;
+}
+
+static int
+dsub (char *r, const char *b, int n)
+{                               // r -= b, n digits, returns borrow out
+   int c = 0;
+   while (n >= 8)
+   {                            // Lanes that borrow wrap to 246 or more, subtracting 246 gives the digit
+      n -= 8;
+      uint64_t x = dload (r + n),
+         y = dload (b + n) + c,
+         s = x - y;
+      uint64_t borrow = ((s ^ x ^ y) >> 8) & DLANES;
+      c = (x < y);
+      borrow |= (uint64_t) c << 56;
+      dstore (r + n, s - borrow * 246);
+   }
+   while (n--)
+   {
+      int v = r[n] - b[n] - c;
+      c = (v < 0);
+      r[n] = v + 10 * c;
+   }
+   return c;
+}
+
+static int
+dmul1 (char *r, const char *b, int n, int q)
+{                               // r = b * q, n digits, q a single digit, returns carry out
+   int c = 0;
+   while (n--)
+   {
+      unsigned v = b[n] * q + c;
+      c = v / 10;
+      r[n] = v - 10 * c;
+   }
+   return c;
+}
+
+static int
+dmul1sub (char *r, const char *b, int n, int q)
+{                               // r -= b * q, n digits, q a single digit, returns borrow out
+   int c = 0;
+   while (n--)
+   {
+      int v = r[n] - b[n] * q - c;
+      c = (unsigned) (9 - v) / 10;      // v is -90 to 9
+      r[n] = v + 10 * c;
+   }
+   return c;
+}
+
+static int
+dlead0 (const char *d, int n)
+{                               // Count leading zero digits
+   int i = 0;
+#ifdef	__SSE2__
+   for (; i + 16 <= n; i += 16)
+   {
+      int m = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (d + i)), _mm_setzero_si128 ()));
+      if (m != 0xFFFF)
+         return i + __builtin_ctz (~m);
+   }
+#endif
+   uint64_t w;
+   for (; i + 8 <= n && !(memcpy (&w, d + i, sizeof (w)), w); i += 8);
+   while (i < n && !d[i])
+      i++;
+   return i;
+}
+
+static int
+dtrail0 (const char *d, int n)
+{                               // Count trailing zero digits
+   int i = n;
+#ifdef	__SSE2__
+   for (; i >= 16; i -= 16)
+   {
+      int m = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (d + i - 16)), _mm_setzero_si128 ()));
+      if (m != 0xFFFF)
+         return n - (i - 16) - (32 - __builtin_clz (~m & 0xFFFF));
+   }
+#endif
+   uint64_t w;
+   for (; i >= 8 && !(memcpy (&w, d + i - 8, sizeof (w)), w); i -= 8);
+   while (i && !d[i - 1])
+      i--;
+   return n - i;
+}
+
+static int
+dadd_scalar (char *r, const char *b, int n)
+{                               // r += b, a digit at a time
+   int c = 0;
+   while (n--)
+   {
+      int v = r[n] + b[n] + c;
+      c = (v >= 10);
+      r[n] = v - 10 * c;
+   }
+   return c;
+}
+
+static int
+dsub_scalar (char *r, const char *b, int n)
+{                               // r -= b, a digit at a time
+   int c = 0;
+   while (n--)
+   {
+      int v = r[n] - b[n] - c;
+      c = (v < 0);
+      r[n] = v + 10 * c;
+   }
+   return c;
+}
+
+static int
+dcmp_scalar (const char *a, const char *b, int n)
+{                               // Compare digits, a digit at a time
+   for (int i = 0; i < n; i++)
+      if (a[i] != b[i])
+         return a[i] < b[i] ? -1 : 1;
+   return 0;
+}
+
+static int
+dcmp (const char *a, const char *b, int n)
+{                               // Compare digits
+   return memcmp (a, b, n);
+}
+
+static int
+dlead0_scalar (const char *d, int n)
+{
+   int i = 0;
+   while (i < n && !d[i])
+      i++;
+   return i;
+}
+
+static int
+dtrail0_scalar (const char *d, int n)
+{
+   int i = n;
+   while (i && !d[i - 1])
+      i--;
+   return n - i;
+}
+
+static void lmul_basic (uint32_t * r, const uint32_t * a, int na, const uint32_t * b, int nb);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define	KERNELS_AVX2
+__attribute__((target ("avx2")))
+static int
+dlead0_avx2 (const char *d, int n)
+{                               // Count leading zero digits, 32 at a time
+   int i = 0;
+   for (; i + 32 <= n; i += 32)
+   {
+      unsigned m = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *) (d + i)), _mm256_setzero_si256 ()));
+      if (m != 0xFFFFFFFFU)
+         return i + __builtin_ctz (~m);
+   }
+   return i + dlead0 (d + i, n - i);
+}
+
+__attribute__((target ("avx2")))
+static int
+dtrail0_avx2 (const char *d, int n)
+{                               // Count trailing zero digits, 32 at a time
+   int i = n;
+   for (; i >= 32; i -= 32)
+   {
+      unsigned m = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *) (d + i - 32)), _mm256_setzero_si256 ()));
+      if (m != 0xFFFFFFFFU)
+         return n - (i - 32) - (32 - __builtin_clz (~m));
+   }
+   return n - i + dtrail0 (d, i);
+}
+
+static void lmul_avx2 (uint32_t * r, const uint32_t * a, int na, const uint32_t * b, int nb);
+
+static int
+avx2_usable (void)
+{
+   return __builtin_cpu_supports ("avx2");
+}
+#endif
+
+// Kernel sets, later entries preferred when usable on this CPU
+static const struct
+{
+   const char *name;
+   int (*usable) (void);
+   int (*dadd) (char *r, const char *b, int n); // r += b, returns carry
+   int (*dsub) (char *r, const char *b, int n); // r -= b, returns borrow
+   int (*dcmp) (const char *a, const char *b, int n);   // Compare, memcmp style
+   int (*dmul1) (char *r, const char *b, int n, int q); // r = b * q, returns carry
+   int (*dmul1sub) (char *r, const char *b, int n, int q);      // r -= b * q, returns borrow
+   int (*dlead0) (const char *d, int n);        // Count leading zeros
+   int (*dtrail0) (const char *d, int n);       // Count trailing zeros
+   void (*lmul_basic) (uint32_t * r, const uint32_t * a, int na, const uint32_t * b, int nb);   // Schoolbook limb multiply
+} kernels[] = {
+   {"scalar", NULL, dadd_scalar, dsub_scalar, dcmp_scalar, dmul1, dmul1sub, dlead0_scalar, dtrail0_scalar, lmul_basic},
+   {"word", NULL, dadd, dsub, dcmp, dmul1, dmul1sub, dlead0, dtrail0, lmul_basic},
+#ifdef	KERNELS_AVX2
+   {"avx2", avx2_usable, dadd, dsub, dcmp, dmul1, dmul1sub, dlead0_avx2, dtrail0_avx2, lmul_avx2},
+#endif
+};
+
+static __typeof__ (kernels[0]) * kern = &kernels[1];     // Process wide, only set by sd_kernels before threads start
+
+const char *
+sd_kernels (const char *name)
+{                               // Select kernels
+   int n = sizeof (kernels) / sizeof (*kernels);
+   while (n--)
+      if ((!name || !strcmp (name, kernels[n].name)) && (!kernels[n].usable || kernels[n].usable ()))
+      {
+         kern = &kernels[n];
+         return kern->name;
+      }
+   return NULL;
+}
+
+static void __attribute__((constructor))
+sd_kernels_init (void)
+{                               // Best for this CPU, unless SD_KERNELS says otherwise
+#ifdef	KERNELS_AVX2
+   __builtin_cpu_init ();       // Constructors can run before the one that sets up __builtin_cpu_supports
+#endif
+   const char *e = getenv ("SD_KERNELS");
+   if (!e || !sd_kernels (e))
+      sd_kernels (NULL);
+}
+
 typedef struct
 {
    sd_val_t *s;
@@ -266,23 +796,23 @@ norm_opts (norm_t o)
 {                               // Normalise (striping leading/trailing 0s)
    if (!o.s)
       return o.s;
-   while (o.s->sig && !o.s->d[0])
+   int n = kern->dlead0 (o.s->d, o.s->sig);
+   if (n)
    {                            // Leading 0s
-      o.s->d++;
-      o.s->mag--;
-      o.s->sig--;
+      o.s->d += n;
+      o.s->mag -= n;
+      o.s->sig -= n;
    }
-   if (!o.pad)
-      while (o.s->sig && !o.s->d[o.s->sig - 1])
-         o.s->sig--;            // Trailing 0
+   if (!o.pad && (n = kern->dtrail0 (o.s->d, o.s->sig)))
+      o.s->sig -= n;            // Trailing 0
    if (o.neg)
       o.s->neg ^= 1;
-   if (!o.s->sig)
+   if (!o.s->sig && (o.s->mag || o.s->neg))
    {                            // zero
       o.s->mag = 0;
       o.s->neg = 0;
    }
-   return o.s;
+   return o.s;                  // Only written if changed, as shared constants such as one are normalised too
 }
 
 typedef struct
@@ -520,6 +1050,30 @@ output_opts (output_t o)
       fputc ('-', O);
    if (o.currency)
       fprintf (O, "%s", o.currency);
+   void put (const char *d, int n)
+   {                            // Digits, or zeros if d is NULL, in bulk, with runs of zeros not converted
+      char b[1024],
+        z[sizeof (b)];
+      int zeros = 0;
+      while (n > 0)
+      {
+         int l = (n < sizeof (b) ? n : sizeof (b));
+         if (!d || kern->dlead0 (d, l) == l)
+         {
+            if (!zeros)
+               memset (z, '0', zeros = sizeof (z));
+            fwrite (z, 1, l, O);
+         } else
+         {
+            for (int i = 0; i < l; i++)
+               b[i] = '0' + d[i];
+            fwrite (b, 1, l, O);
+         }
+         if (d)
+            d += l;
+         n -= l;
+      }
+   }
    int q = 0;
    if (s->mag < 0)
    {
@@ -531,11 +1085,20 @@ output_opts (output_t o)
       {
          if (!o.combined || sd_point != '.')
             fputc (sd_point, O);
-         for (q = 0; q < -1 - s->mag; q++)
-            fputc ('0', O);
-         for (q = 0; q < s->sig; q++)
-            fputc ('0' + s->d[q], O);
+         put (NULL, -1 - s->mag);
+         put (s->d, s->sig);
       }
+   } else if (!o.comma && !o.combined)
+   {                            // Plain digits, point, and trailing zeros in bulk
+      q = (s->sig < s->mag + 1 ? s->sig : s->mag + 1);
+      put (s->d, q);
+      if (s->sig > q)
+      {
+         if (sd_point)
+            fputc (sd_point, O);
+         put (s->d + q, s->sig - q);
+      } else
+         put (NULL, s->mag + 1 - q);
    } else
    {
       void nextdigit (int v)
@@ -662,19 +1225,13 @@ ucmp (const char **failp, sd_val_t * a, sd_val_t * b, int boffset)
    int sig = a->sig;            // Max digits to compare
    if (b->sig < sig)
       sig = b->sig;
-   int p;
-   for (p = 0; p < sig && a->d[p] == b->d[p]; p++);
-   if (p < sig)
-   {                            // Compare digit as not reached end
-      if (a->d[p] < b->d[p])
-         return -1;
-      if (a->d[p] > b->d[p])
-         return 1;
-   }
+   int diff = kern->dcmp (a->d, b->d, sig);
+   if (diff)
+      return diff < 0 ? -1 : 1;
    // Compare length
-   if (a->sig > p)
+   if (a->sig > sig)
       return 1;                 // More digits
-   if (b->sig > p)
+   if (b->sig > sig)
       return -1;                // More digits
    return 0;
 }
@@ -706,19 +1263,24 @@ uadd_opts (const char **failp, uadd_t o)
    {                            // Check if we can use a
       if (a->mag + (a->d - a->m) >= mag && a->mag + (a->d - a->m) - a->max <= end)
       {                         // reuse a
-         while (a->mag < mag)
-         {
-            *--a->d = 0;
-            a->mag++;
-            a->sig++;
+         if (a->mag < mag)
+         {                      // Leading zeros in bulk
+            int n = mag - a->mag;
+            a->d -= n;
+            memset (a->d, 0, n);
+            a->mag += n;
+            a->sig += n;
          }
          if (!a->sig && a->mag > mag)
          {
             a->d += a->mag - mag;
             a->mag = mag;
          }
-         while (a->sig < mag - end)
-            a->d[a->sig++] = 0;
+         if (a->sig < mag - end)
+         {                      // Trailing zeros in bulk
+            memset (a->d + a->sig, 0, mag - end - a->sig);
+            a->sig = mag - end;
+         }
          r = a;
          o.a_free = 0;
       } else
@@ -728,27 +1290,22 @@ uadd_opts (const char **failp, uadd_t o)
    if (!r)
       r = make (failp, mag, mag - end);
    if (r)
-   {
-      int c = 0;
-      for (int p = end + 1; p <= mag; p++)
+   {                            // a in place, then b added over its own digits, then any carry
+      if (r != a && a->sig)
+         memcpy (r->d + r->mag - a->mag, a->d, a->sig);
+      if (b->sig)
       {
-         int v = c;
-         if (p <= a->mag && p > a->mag - a->sig)
-            v += a->d[a->mag - p];
-         if (p <= o.boffset + b->mag && p > o.boffset + b->mag - b->sig)
-            v += b->d[o.boffset + b->mag - p];
-         c = 0;
-         if (v >= 10)
+         char *p = r->d + r->mag - (o.boffset + b->mag);
+         int c = kern->dadd (p, b->d, b->sig);
+         while (c)
          {
-            c = 1;
-            v -= 10;
+            if (--p < r->d)
+               errx (1, "Carry add error %d", c);
+            c = (++*p == 10);
+            if (c)
+               *p = 0;
          }
-         if (!(p <= r->mag && p > r->mag - r->sig))
-            errx (1, "uadd fail");
-         r->d[r->mag - p] = v;
       }
-      if (c)
-         errx (1, "Carry add error %d", c);
    }
    if (o.a_free)
       freez (o.a);
@@ -803,88 +1360,1252 @@ usub_opts (const char **failp, usub_t o)
    if (!r)
       r = make (failp, mag, mag - end);
    if (r)
-   {
-      int c = 0;
-      for (int p = end + 1; p <= mag; p++)
+   {                            // a in place, then b taken off over its own digits, then any borrow
+      if (r != a && a->sig)
+         memcpy (r->d + r->mag - a->mag, a->d, a->sig);
+      if (b->sig)
       {
-         int v = c;
-         if (p <= a->mag && p > a->mag - a->sig)
-            v += a->d[a->mag - p];
-         if (p <= o.boffset + b->mag && p > o.boffset + b->mag - b->sig)
-            v -= b->d[o.boffset + b->mag - p];
-         c = 0;
-         if (v < 0)
+         char *p = r->d + r->mag - (o.boffset + b->mag);
+         int c = kern->dsub (p, b->d, b->sig);
+         while (c)
          {
-            c = -1;
-            v += 10;
+            if (--p < r->d)
+               errx (1, "Carry sub error %d", c);
+            c = !*p;
+            *p = (c ? 9 : *p - 1);
          }
-         r->d[r->mag - p] = v;
       }
-      if (c)
-         errx (1, "Carry sub error %d", c);
    }
    if (o.a_free)
       freez (o.a);
  return norm (r, neg:o.neg);
 }
 
-static void
-makebase (const char **failp, sd_val_t * r[9], sd_val_t * a)
-{                               // Make array of multiples of a, 1 to 9, used for multiply and divide
-   r[0] = copy (failp, a);
-   for (int n = 1; n < 9; n++)
-      r[n] = uadd (failp, r[n - 1], a);
+// Limbs, 9 decimal digits packed in to each uint32_t, least significant limb first
+// The heavier kernels work on these, with sd_val_t staying one digit per byte so mag/sig mean the same everywhere
+
+typedef uint32_t limb_t;
+#define	LIMB_DIGITS	9
+#define	LIMB_BASE	1000000000U
+
+static const limb_t limb_pow10[LIMB_DIGITS] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+static inline int
+limbs (int digits)
+{                               // Limbs needed to hold digits
+   return (digits + LIMB_DIGITS - 1) / LIMB_DIGITS;
 }
 
 static void
-free_base (sd_val_t * r[9])
-{
-   for (int n = 0; n < 9; n++)
-      freez (r[n]);
+tolimbs (sd_val_t * a, int end, limb_t * l, int n)
+{                               // Pack a in to n limbs, first limb holds positions end+1 to end+9, end must be at or below last digit
+   memset (l, 0, n * sizeof (*l));
+   int o = a->mag - a->sig - end;       // Offset of last digit above end+1
+   int i = o / LIMB_DIGITS,
+      k = o % LIMB_DIGITS;
+   for (int q = a->sig - 1; q >= 0 && i < n; q--)
+   {
+      l[i] += a->d[q] * limb_pow10[k];
+      if (++k == LIMB_DIGITS)
+      {
+         k = 0;
+         i++;
+      }
+   }
 }
 
-typedef struct
-{
-   sd_val_t *a;
-   sd_val_t *b;
-   unsigned char neg:1;
-   unsigned char a_free:1;
-   unsigned char b_free:1;
-} umul_t;
-#define umul(failp,...) umul_opts(failp,(umul_t){__VA_ARGS__})
 static sd_val_t *
-umul_opts (const char **failp, umul_t o)
-{                               // Unsigned mul (i.e. final sign already set in r) and set in r if needed
-   sd_val_t *a = o.a ? : &zero;
-   sd_val_t *b = o.b ? : &zero;
-   debugout ("umul", a, b, NULL);
-   sd_val_t *base[9];
-   makebase (failp, base, b);
-   int mag = a->mag + b->mag + 4;       // Allow plenty of space
-   int sig = a->sig + b->sig + 10;
-   sd_val_t *r = make (failp, mag, sig);
-   r->sig = 0;                  // Is zero, we just made it big enough to re-use
-   for (int p = 0; p < a->sig; p++)
-      if (a->d[p])
-       r = uadd (failp, r, base[a->d[p] - 1], boffset: a->mag - p, a_free:1);
-   free_base (base);
-   if (o.a_free)
-      freez (o.a);
-   if (o.b_free)
-      freez (o.b);
- return norm (r, neg:o.neg);
+fromlimbs (const char **failp, const limb_t * l, int n, int end)
+{                               // Unpack n limbs to a new value, first limb holds positions end+1 to end+9
+   while (n && !l[n - 1])
+      n--;                      // Leading zero limbs
+   sd_val_t *r = make (failp, end + n * LIMB_DIGITS, n * LIMB_DIGITS);
+   if (!r)
+      return r;
+   char *d = r->d + r->sig;
+   for (int i = 0; i < n; i++)
+   {
+      limb_t v = l[i];
+      for (int k = 0; k < LIMB_DIGITS; k++)
+      {
+         *--d = v % 10;
+         v /= 10;
+      }
+   }
+   return norm (r);
 }
 
-typedef struct
-{
-   sd_val_t *a;
-   sd_val_t *b;
-   sd_val_t **rem;
-   int places;
-   sd_round_t round;
-   unsigned char neg:1;         // Negative
-   unsigned char pad:1;         // Pad to specified places
-   unsigned char sig:1;         // Places is sig figures
+static int
+lcmp (const limb_t * a, int na, const limb_t * b, int nb)
+{                               // Compare limbs, 1 if a>b, -1 if a<b, else 0
+   while (na && !a[na - 1])
+      na--;
+   while (nb && !b[nb - 1])
+      nb--;
+   if (na != nb)
+      return na > nb ? 1 : -1;
+   while (na--)
+      if (a[na] != b[na])
+         return a[na] > b[na] ? 1 : -1;
+   return 0;
+}
+
+static int
+ladd (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a + b, r may be a or b and needs one more limb than the longer, returns limbs
+   if (na < nb)
+   {
+      const limb_t *t = a;
+      a = b;
+      b = t;
+      int n = na;
+      na = nb;
+      nb = n;
+   }
+   limb_t c = 0;
+   int i;
+   for (i = 0; i < nb; i++)
+   {
+      limb_t v = a[i] + b[i] + c;
+      c = (v >= LIMB_BASE);
+      r[i] = v - (c ? LIMB_BASE : 0);
+   }
+   for (; i < na; i++)
+   {
+      limb_t v = a[i] + c;
+      c = (v >= LIMB_BASE);
+      r[i] = v - (c ? LIMB_BASE : 0);
+   }
+   r[i] = c;
+   return na + c;
+}
+
+static int
+lsub (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a - b, assumes a >= b, r may be a, returns limbs without leading zeros
+   while (nb && !b[nb - 1])
+      nb--;
+   limb_t c = 0;
+   int i;
+   for (i = 0; i < nb; i++)
+   {
+      limb_t s = b[i] + c;
+      c = (a[i] < s);
+      r[i] = a[i] - s + (c ? LIMB_BASE : 0);
+   }
+   for (; i < na; i++)
+   {
+      limb_t v = a[i];
+      r[i] = (c && !v) ? LIMB_BASE - 1 : v - c;
+      c = (c && !v);
+   }
+   while (na && !r[na - 1])
+      na--;
+   return na;
+}
+
+static void
+laddat (limb_t * r, int nr, const limb_t * a, int na, int at)
+{                               // r += a shifted up at limbs, carry stays within the nr limbs of r
+   while (na && !a[na - 1])
+      na--;
+   limb_t c = 0;
+   int i;
+   for (i = 0; i < na; i++)
+   {
+      limb_t v = r[at + i] + a[i] + c;
+      c = (v >= LIMB_BASE);
+      r[at + i] = v - (c ? LIMB_BASE : 0);
+   }
+   for (i += at; c && i < nr; i++)
+   {
+      c = (r[i] == LIMB_BASE - 1);
+      r[i] = c ? 0 : r[i] + 1;
+   }
+}
+
+static int
+lmul1 (limb_t * r, const limb_t * a, int n, limb_t m)
+{                               // r = a * m, r may be a and needs n+1 limbs, returns limbs
+   uint64_t c = 0;
+   for (int i = 0; i < n; i++)
+   {
+      c += (uint64_t) a[i] * m;
+      r[i] = c % LIMB_BASE;
+      c /= LIMB_BASE;
+   }
+   r[n] = c;
+   return n + !!c;
+}
+
+static limb_t
+ldiv1 (limb_t * r, const limb_t * a, int n, limb_t m)
+{                               // r = a / m, r may be a, returns remainder
+   uint64_t c = 0;
+   while (n--)
+   {
+      c = c * LIMB_BASE + a[n];
+      r[n] = c / m;
+      c %= m;
+   }
+   return c;
+}
+
+static limb_t
+lmuladd (limb_t * r, const limb_t * a, int n, limb_t m)
+{                               // r += a * m, over n limbs, returns carry limb
+   uint64_t c = 0;
+   for (int i = 0; i < n; i++)
+   {
+      c += (uint64_t) a[i] * m + r[i];
+      r[i] = c % LIMB_BASE;
+      c /= LIMB_BASE;
+   }
+   return c;
+}
+
+// Multiply thresholds, in limbs of the shorter operand
+#define	LIMB_KARATSUBA	32      // Schoolbook below this
+#define	LIMB_KARATSUBA_SQR	64      // Schoolbook below this when squaring, which does half the work
+#define	LIMB_TOOM3	160     // Karatsuba below this
+
+static void lmul (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb);
+
+static void
+lmul_basic (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, schoolbook
+   memset (r, 0, (na + nb) * sizeof (*r));
+   for (int i = 0; i < na; i++)
+      if (a[i])
+         r[i + nb] = lmuladd (r + i, b, nb, a[i]);
+}
+
+#ifdef	KERNELS_AVX2
+__attribute__((target ("avx2")))
+static void
+lmul_avx2 (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, schoolbook summing 64 bit columns four at a time, carrying every 16 rows so columns cannot overflow
+   uint64_t s[256],
+    *t = s;
+   if (na + nb + 1 > sizeof (s) / sizeof (*s) && !(t = malloc ((na + nb + 1) * sizeof (*t))))
+   {
+      lmul_basic (r, a, na, b, nb);     // No space, schoolbook needs none
+      return;
+   }
+   memset (t, 0, (na + nb + 1) * sizeof (*t));
+   int lo = 0;                  // Lowest column not yet carried
+   void carry (int top)
+   {
+      uint64_t c = 0;
+      for (; lo < top || c; lo++)
+      {
+         c += t[lo];
+         t[lo] = c % LIMB_BASE;
+         c /= LIMB_BASE;
+      }
+   }
+   for (int i = 0; i < na; i++)
+   {
+      __m256i m = _mm256_set1_epi64x (a[i]);
+      uint64_t *c = t + i;
+      int j = 0;
+      for (; j + 4 <= nb; j += 4)
+      {
+         __m256i x = _mm256_cvtepu32_epi64 (_mm_loadu_si128 ((const __m128i *) (b + j)));
+         _mm256_storeu_si256 ((__m256i *) (c + j), _mm256_add_epi64 (_mm256_loadu_si256 ((const __m256i *) (c + j)), _mm256_mul_epu32 (x, m)));
+      }
+      for (; j < nb; j++)
+         c[j] += (uint64_t) a[i] * b[j];
+      if ((i & 15) == 15)
+      {                         // Columns below i+1 are final, carry up through those touched
+         int keep = lo;
+         carry (i + nb);
+         lo = (keep > i + 1 ? keep : i + 1);
+      }
+   }
+   carry (na + nb);
+   for (int k = 0; k < na + nb; k++)
+      r[k] = t[k];
+   if (t != s)
+      free (t);
+}
+#endif
+
+static void
+lsqr_basic (limb_t * r, const limb_t * a, int n)
+{                               // r = a * a, schoolbook doing each cross product once
+   memset (r, 0, 2 * n * sizeof (*r));
+   for (int i = 0; i + 1 < n; i++)
+      if (a[i])
+         r[i + n] = lmuladd (r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+   limb_t c = 0;
+   for (int i = 0; i < 2 * n; i++)
+   {                            // Double
+      limb_t v = r[i] * 2 + c;
+      c = (v >= LIMB_BASE);
+      r[i] = v - (c ? LIMB_BASE : 0);
+   }
+   for (int i = 0; i < n; i++)
+      if (a[i])
+      {                         // Add squares
+         uint64_t v = (uint64_t) a[i] * a[i];
+         limb_t s[2] = { v % LIMB_BASE, v / LIMB_BASE };
+         laddat (r, 2 * n, s, 2, 2 * i);
+      }
+}
+
+static void
+lkaratsuba (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, for na >= nb > na/2, splitting in two, three half size multiplies
+   int h = (na + 1) / 2;
+   char sqr = (a == b && na == nb);
+   limb_t *t = malloc ((4 * h + 6) * sizeof (*t));
+   if (!t)
+   {
+      lmul_basic (r, a, na, b, nb);     // No space, schoolbook needs none
+      return;
+   }
+   limb_t *sa = t,
+      *sb = sa + h + 2,
+      *z1 = sb + h + 2;
+   memset (r, 0, (na + nb) * sizeof (*r));
+   lmul (r, a, h, b, h);        // z0
+   if (nb > h)
+      lmul (r + 2 * h, a + h, na - h, b + h, nb - h);   // z2
+   int nsa = ladd (sa, a, h, a + h, na - h),
+      nsb = nsa;
+   if (sqr)
+      sb = sa;
+   else
+      nsb = ladd (sb, b, h, b + h, nb - h);
+   lmul (z1, sa, nsa, sb, nsb);
+   int nz1 = lsub (z1, z1, nsa + nsb, r, 2 * h);
+   nz1 = lsub (z1, z1, nz1, r + 2 * h, na + nb - 2 * h);
+   laddat (r, na + nb, z1, nz1, h);
+   free (t);
+}
+
+static void
+ltoom3 (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, for na >= nb > na/2, splitting in three, evaluated at 0, 1, -1, 2 and infinity
+   int k = (na + 2) / 3;
+   char sqr = (a == b && na == nb);
+   int l = k + 3;               // Evaluated operand space
+   int L = 2 * l + 2;           // Product space
+   limb_t *t = malloc ((7 * l + 3 * L) * sizeof (*t));
+   if (!t)
+   {
+      lmul_basic (r, a, na, b, nb);     // No space, schoolbook needs none
+      return;
+   }
+   limb_t *w = t,               // Working space
+      *pa1 = w + l,
+      *pam = pa1 + l,
+      *pa2 = pam + l,
+      *pb1 = pa2 + l,
+      *pbm = pb1 + l,
+      *pb2 = pbm + l,
+      *r1 = pb2 + l,
+      *rm = r1 + L,
+      *r2 = rm + L;
+   void eval (const limb_t * x, int n, limb_t * p1, int *n1, limb_t * pm, int *nm, char *negm, limb_t * p2, int *n2)
+   {                            // Evaluate x at 1, -1 and 2
+      int x0 = n < k ? n : k,
+         x1 = n - k < 0 ? 0 : n - k < k ? n - k : k,
+         x2 = n - 2 * k < 0 ? 0 : n - 2 * k;
+      const limb_t *X1 = x + k,
+         *X2 = x + 2 * k;
+      int nw = ladd (w, x, x0, X2, x2);
+      *n1 = ladd (p1, w, nw, X1, x1);
+      *negm = (lcmp (w, nw, X1, x1) < 0);
+      if (*negm)
+         *nm = lsub (pm, X1, x1, w, nw);
+      else
+         *nm = lsub (pm, w, nw, X1, x1);
+      *n2 = lmul1 (p2, X2, x2, 2);
+      *n2 = ladd (p2, p2, *n2, X1, x1);
+      *n2 = lmul1 (p2, p2, *n2, 2);
+      *n2 = ladd (p2, p2, *n2, x, x0);
+   }
+   int na1,
+     nam,
+     na2,
+     nb1,
+     nbm,
+     nb2;
+   char sa,
+     sb;
+   eval (a, na, pa1, &na1, pam, &nam, &sa, pa2, &na2);
+   if (sqr)
+   {
+      pb1 = pa1;
+      pbm = pam;
+      pb2 = pa2;
+      nb1 = na1;
+      nbm = nam;
+      nb2 = na2;
+      sb = sa;
+   } else
+      eval (b, nb, pb1, &nb1, pbm, &nbm, &sb, pb2, &nb2);
+   // Point products, 0 and infinity go straight in to r
+   int c0 = k + (nb < k ? nb : k),
+      c4 = nb > 2 * k ? na + nb - 4 * k : 0;
+   memset (r, 0, (na + nb) * sizeof (*r));
+   lmul (r, a, k, b, nb < k ? nb : k);
+   if (c4)
+      lmul (r + 4 * k, a + 2 * k, na - 2 * k, b + 2 * k, nb - 2 * k);
+   lmul (r1, pa1, na1, pb1, nb1);
+   lmul (rm, pam, nam, pbm, nbm);
+   lmul (r2, pa2, na2, pb2, nb2);
+   int n1 = na1 + nb1,
+      nm = nam + nbm,
+      n2 = na2 + nb2,
+      ns;
+   char neg = sa ^ sb;
+   limb_t *s = w;               // c2, w is free now, and big enough as evaluation spaces follow
+   // s = (r1 + r(-1)) / 2 = c0 + c2 + c4
+   if (neg)
+      ns = lsub (s, r1, n1, rm, nm);
+   else
+      ns = ladd (s, r1, n1, rm, nm);
+   ldiv1 (s, s, ns, 2);
+   // r1 = (r1 - r(-1)) / 2 = c1 + c3
+   if (neg)
+      n1 = ladd (r1, r1, n1, rm, nm);
+   else
+      n1 = lsub (r1, r1, n1, rm, nm);
+   ldiv1 (r1, r1, n1, 2);
+   // s = c2
+   ns = lsub (s, s, ns, r, c0);
+   ns = lsub (s, s, ns, r + 4 * k, c4);
+   // r2 = (r2 - c0 - 4c2 - 16c4) / 2 = c1 + 4c3
+   n2 = lsub (r2, r2, n2, r, c0);
+   nm = lmul1 (rm, s, ns, 4);
+   n2 = lsub (r2, r2, n2, rm, nm);
+   nm = lmul1 (rm, r + 4 * k, c4, 16);
+   n2 = lsub (r2, r2, n2, rm, nm);
+   ldiv1 (r2, r2, n2, 2);
+   // r2 = c3 = (r2 - r1) / 3, r1 = c1 = r1 - c3
+   n2 = lsub (r2, r2, n2, r1, n1);
+   ldiv1 (r2, r2, n2, 3);
+   n1 = lsub (r1, r1, n1, r2, n2);
+   laddat (r, na + nb, r1, n1, k);
+   laddat (r, na + nb, s, ns, 2 * k);
+   laddat (r, na + nb, r2, n2, 3 * k);
+   free (t);
+}
+
+#ifdef	__SIZEOF_INT128__
+// Number theoretic transform multiply, for the very large, exact by working modulo three primes and combining with CRT
+// The primes' product (~1.6e26) exceeds any convolution term, n * (LIMB_BASE-1)^2, for transforms up to NTT_MAX
+
+#define	LIMB_NTT	6144    // Toom-3 below this
+#define	NTT_MAX	(1 << 25)       // Largest transform all three primes allow
+
+static const struct
+{
+   uint32_t p;                  // Prime, k * 2^n + 1, with 2^n >= NTT_MAX
+   uint32_t g;                  // Primitive root
+} ntt_prime[3] = {
+   {469762049, 3},
+   {167772161, 3},
+   {2013265921, 31},
+};
+
+typedef struct
+{                               // Montgomery form constants
+   uint32_t p;                  // Prime
+   uint32_t pinv;               // -1/p mod 2^32
+   uint32_t r2;                 // 2^64 mod p
+} ntt_mod_t;
+
+static inline uint32_t
+nmul (const ntt_mod_t * m, uint32_t a, uint32_t b)
+{                               // Montgomery multiply
+   uint64_t t = (uint64_t) a * b;
+   uint32_t q = (uint32_t) t * m->pinv;
+   uint32_t u = (t + (uint64_t) q * m->p) >> 32;
+   return u >= m->p ? u - m->p : u;
+}
+
+static uint32_t
+npow (const ntt_mod_t * m, uint32_t b, uint32_t e)
+{                               // Montgomery power
+   uint32_t r = nmul (m, 1, m->r2);
+   while (e)
+   {
+      if (e & 1)
+         r = nmul (m, r, b);
+      b = nmul (m, b, b);
+      e >>= 1;
+   }
+   return r;
+}
+
+static uint64_t
+modpow (uint64_t b, uint64_t e, uint64_t p)
+{                               // Plain modular power, p < 2^32
+   uint64_t r = 1;
+   b %= p;
+   while (e)
+   {
+      if (e & 1)
+         r = r * b % p;
+      b = b * b % p;
+      e >>= 1;
+   }
+   return r;
+}
+
+static void
+ntt (const ntt_mod_t * m, uint32_t * a, int n, uint32_t g, char inverse, uint32_t * w)
+{                               // In place transform of n (power of 2) values in Montgomery form, g the root in Montgomery form, w n/2 scratch
+   for (int i = 1, j = 0; i < n; i++)
+   {                            // Bit reverse order
+      int bit = n >> 1;
+      for (; j & bit; bit >>= 1)
+         j ^= bit;
+      j ^= bit;
+      if (i < j)
+      {
+         uint32_t t = a[i];
+         a[i] = a[j];
+         a[j] = t;
+      }
+   }
+   for (int len = 2; len <= n; len <<= 1)
+   {
+      int h = len / 2;
+      uint32_t wl = npow (m, g, (m->p - 1) / len);
+      if (inverse)
+         wl = npow (m, wl, m->p - 2);
+      w[0] = nmul (m, 1, m->r2);
+      for (int j = 1; j < h; j++)
+         w[j] = nmul (m, w[j - 1], wl);
+      for (int i = 0; i < n; i += len)
+         for (int j = 0; j < h; j++)
+         {
+            uint32_t u = a[i + j],
+               v = nmul (m, a[i + j + h], w[j]);
+            a[i + j] = (u + v >= m->p) ? u + v - m->p : u + v;
+            a[i + j + h] = (u >= v) ? u - v : u + m->p - v;
+         }
+   }
+}
+
+static void
+lntt (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, na+nb <= NTT_MAX, passing the same a and b squares
+   char sqr = (a == b && na == nb);
+   int n = 1;
+   while (n < na + nb)
+      n <<= 1;
+   uint32_t *t = malloc ((4 * (size_t) n + n / 2) * sizeof (*t));
+   if (!t)
+   {
+      lmul_basic (r, a, na, b, nb);     // No space, schoolbook needs none
+      return;
+   }
+   uint32_t *res[3] = { t, t + n, t + 2 * n },
+      *fb = t + 3 * n,
+      *w = t + 4 * n;
+   for (int k = 0; k < 3; k++)
+   {
+      ntt_mod_t m = { ntt_prime[k].p };
+      uint32_t x = m.p;
+      for (int i = 0; i < 5; i++)
+         x *= 2 - m.p * x;      // Newton for 1/p mod 2^32
+      m.pinv = -x;
+      m.r2 = modpow (1ULL << 32, 2, m.p);
+      uint32_t g = nmul (&m, ntt_prime[k].g, m.r2);
+      uint32_t *fa = res[k];
+      for (int s = 0; s < 2 - sqr; s++)
+      {                         // Load and transform each operand
+         uint32_t *f = s ? fb : fa;
+         const limb_t *x = s ? b : a;
+         int nx = s ? nb : na;
+         for (int i = 0; i < nx; i++)
+            f[i] = nmul (&m, x[i] % m.p, m.r2);
+         memset (f + nx, 0, (n - nx) * sizeof (*f));
+         ntt (&m, f, n, g, 0, w);
+      }
+      uint32_t *f = sqr ? fa : fb;
+      uint32_t ninv = nmul (&m, modpow (n, m.p - 2, m.p), m.r2);
+      for (int i = 0; i < n; i++)
+         fa[i] = nmul (&m, nmul (&m, fa[i], f[i]), ninv);
+      ntt (&m, fa, n, g, 1, w);
+      for (int i = 0; i < na + nb; i++)
+         fa[i] = nmul (&m, fa[i], 1);   // Out of Montgomery form
+   }
+   // Garner's CRT, then carry in to limbs
+   const uint64_t p0 = ntt_prime[0].p,
+      p1 = ntt_prime[1].p,
+      p2 = ntt_prime[2].p;
+   const uint64_t i01 = modpow (p0, p1 - 2, p1),
+      i012 = modpow (p0 * p1 % p2, p2 - 2, p2);
+   unsigned __int128 c = 0;
+   for (int i = 0; i < na + nb; i++)
+   {
+      uint64_t r0 = res[0][i],
+         t1 = (res[1][i] + p1 - r0 % p1) % p1 * i01 % p1,
+         x01 = r0 + p0 * t1,
+         t2 = (res[2][i] + p2 - x01 % p2) % p2 * i012 % p2;
+      c += x01 + (unsigned __int128) (p0 * p1) * t2;
+      r[i] = c % LIMB_BASE;
+      c /= LIMB_BASE;
+   }
+   free (t);
+}
+#endif
+
+static void
+lmul (limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // r = a * b, r is na+nb limbs, passing the same a and b squares
+   if (na < nb)
+   {
+      const limb_t *t = a;
+      a = b;
+      b = t;
+      int n = na;
+      na = nb;
+      nb = n;
+   }
+   if (a == b && na == nb && na < LIMB_KARATSUBA_SQR)
+      lsqr_basic (r, a, na);
+#ifdef	__SIZEOF_INT128__
+   else if (nb >= LIMB_NTT && na + nb <= NTT_MAX)
+      lntt (r, a, na, b, nb);
+#endif
+   else if (nb < LIMB_KARATSUBA)
+      kern->lmul_basic (r, a, na, b, nb);
+   else if (na > 2 * nb)
+   {                            // Unbalanced, do in nb sized chunks of a
+      limb_t *t = malloc (2 * nb * sizeof (*t));
+      if (!t)
+      {
+         lmul_basic (r, a, na, b, nb);  // No space, schoolbook needs none
+         return;
+      }
+      memset (r, 0, (na + nb) * sizeof (*r));
+      for (int i = 0; i < na; i += nb)
+      {
+         int n = (na - i < nb ? na - i : nb);
+         lmul (t, a + i, n, b, nb);
+         laddat (r, na + nb, t, n + nb, i);
+      }
+      free (t);
+   } else if (nb < LIMB_TOOM3)
+      lkaratsuba (r, a, na, b, nb);
+   else
+      ltoom3 (r, a, na, b, nb);
+}
+
+static limb_t
+lmulsub (limb_t * r, const limb_t * a, int n, limb_t m)
+{                               // r -= a * m, over n limbs, returns borrow limb
+   uint64_t c = 0;
+   for (int i = 0; i < n; i++)
+   {
+      c += (uint64_t) a[i] * m;
+      limb_t s = c % LIMB_BASE;
+      c /= LIMB_BASE;
+      if (r[i] < s)
+      {
+         r[i] += LIMB_BASE - s;
+         c++;
+      } else
+         r[i] -= s;
+   }
+   return c;
+}
+
+// Divide threshold, in limbs of both divisor and quotient
+#define	LIMB_NEWTON	128     // Schoolbook below this
+
+static __thread char lnomem;    // A limb divide could not get working space, the result is not valid
+
+static int
+lnomem_fail (const char **failp)
+{                               // Pick up a limb divide failure, for callers that have a failp
+   if (!lnomem)
+      return 0;
+   lnomem = 0;
+   if (failp && !*failp)
+      *failp = "Malloc failed";
+   return 1;
+}
+
+static void
+ldiv_basic (limb_t * q, limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // q = a / b, r = a % b, schoolbook (Knuth D), na >= nb >= 2, b has non zero top limb
+   limb_t f = LIMB_BASE / (b[nb - 1] + 1);      // Normalise so top limb of divisor is at least half base
+   limb_t *t = malloc ((na + nb + 2) * sizeof (*t));
+   if (!t)
+   {
+      lnomem = 1;
+      return;
+   }
+   limb_t *u = t,
+      *v = t + na + 1;
+   lmul1 (u, a, na, f);
+   lmul1 (v, b, nb, f);
+   limb_t vt = v[nb - 1],
+      vs = v[nb - 2];
+   for (int j = na - nb; j >= 0; j--)
+   {
+      uint64_t n = (uint64_t) u[j + nb] * LIMB_BASE + u[j + nb - 1],
+         qh = n / vt,
+         rh = n % vt;
+      while (qh >= LIMB_BASE || qh * vs > rh * LIMB_BASE + u[j + nb - 2])
+      {                         // Estimate at most two over
+         qh--;
+         rh += vt;
+         if (rh >= LIMB_BASE)
+            break;
+      }
+      limb_t c = lmulsub (u + j, v, nb, qh);
+      if (u[j + nb] < c)
+      {                         // Rare case of one over, add back
+         qh--;
+         limb_t k = 0;
+         for (int i = 0; i < nb; i++)
+         {
+            limb_t s = u[j + i] + v[i] + k;
+            k = (s >= LIMB_BASE);
+            u[j + i] = s - (k ? LIMB_BASE : 0);
+         }
+      }
+      u[j + nb] = 0;
+      q[j] = qh;
+   }
+   ldiv1 (r, u, nb, f);
+   free (t);
+}
+
+static void ldivmod (limb_t * q, limb_t * r, const limb_t * a, int na, const limb_t * b, int nb);
+
+static void
+lrecip (limb_t * x, const limb_t * d, int t)
+{                               // x = B^2t / d, rounded down, d is t limbs with non zero top limb, x is t+2 limbs
+   limb_t *w = calloc (4 * t + 6, sizeof (*w));
+   if (!w)
+   {
+      lnomem = 1;
+      return;
+   }
+   limb_t *p = w,               // B^2t, 2t+1 limbs
+      *m = p + 2 * t + 1;       // Products, 2t+3 limbs
+   p[2 * t] = 1;
+   memset (x, 0, (t + 2) * sizeof (*x));
+   if (t < LIMB_NEWTON)
+      ldivmod (x, m, p, 2 * t + 1, d, t);
+   else
+   {                            // Newton step from a half precision reciprocal of the top of d
+      int h = t / 2 + 2;
+      lrecip (x + t - h, d + t - h, h);
+      limb_t *e = NULL,
+         *xm = NULL;
+      if (lnomem)
+      {
+         free (w);
+         return;
+      }
+      lmul (m, d, t, x, t + 2);
+      int nm = 2 * t + 2,
+         ne;
+      if (!(e = malloc ((2 * t + 2) * sizeof (*e))))
+      {
+         lnomem = 1;
+         free (w);
+         return;
+      }
+      char over = (lcmp (m, nm, p, 2 * t + 1) > 0);
+      if (over)
+         ne = lsub (e, m, nm, p, 2 * t + 1);
+      else
+         ne = lsub (e, p, 2 * t + 1, m, nm);
+      // x +/- x * e / B^2t
+      if (!(xm = malloc ((t + 2 + ne) * sizeof (*xm))))
+      {
+         lnomem = 1;
+         free (e);
+         free (w);
+         return;
+      }
+      lmul (xm, x, t + 2, e, ne);
+      int nx = t + 2 + ne - 2 * t;
+      if (nx > 0 && over)
+         lsub (x, x, t + 2, xm + 2 * t, nx);
+      else if (nx > 0)
+         laddat (x, t + 2, xm + 2 * t, nx, 0);
+      free (xm);
+      free (e);
+      // Correct to exactly rounded down
+      limb_t one = 1;
+      lmul (m, d, t, x, t + 2);
+      while (lcmp (m, nm, p, 2 * t + 1) > 0)
+      {
+         lsub (x, x, t + 2, &one, 1);
+         lsub (m, m, nm, d, t);
+      }
+      while (1)
+      {
+         ladd (m, m, nm, d, t);
+         if (lcmp (m, nm + 1, p, 2 * t + 1) > 0)
+            break;
+         laddat (x, t + 2, &one, 1, 0);
+      }
+   }
+   free (w);
+}
+
+static void
+lnewton (limb_t * q, limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // q = a / b, r = a % b, using reciprocal of top of b, quotient limbs no more than nb
+   int nq = na - nb + 1,
+      t = (nb < nq + 2 ? nb : nq + 2),
+      s = nb - t;
+   limb_t *w = malloc (((t + 2) + (na - s + t + 2) + (nq + 1 + nb) + na) * sizeof (*w));
+   if (!w)
+   {
+      ldiv_basic (q, r, a, na, b, nb);  // Less space
+      return;
+   }
+   limb_t *x = w,
+      *m = x + t + 2,
+      *p = m + na - s + t + 2,
+      *u = p + nq + 1 + nb;
+   lrecip (x, b + s, t);
+   if (lnomem)
+   {
+      free (w);
+      return;
+   }
+   lmul (m, a + s, na - s, x, t + 2);   // Estimate, at most a few under
+   limb_t *qe = m + 2 * t;
+   int ne = na - s + t + 2 - 2 * t;
+   if (ne > nq + 1)
+      ne = nq + 1;
+   lmul (p, qe, ne, b, nb);
+   int np = ne + nb;
+   limb_t one = 1;
+   while (lcmp (p, np, a, na) > 0)
+   {                            // Over
+      lsub (qe, qe, ne, &one, 1);
+      np = lsub (p, p, np, b, nb);
+   }
+   int nu = lsub (u, a, na, p, np);
+   while (lcmp (u, nu, b, nb) >= 0)
+   {                            // Under
+      laddat (qe, ne, &one, 1, 0);
+      nu = lsub (u, u, nu, b, nb);
+   }
+   memcpy (q, qe, nq * sizeof (*q));
+   memset (r, 0, nb * sizeof (*r));
+   memcpy (r, u, nu * sizeof (*r));
+   free (w);
+}
+
+static void
+ldivmod (limb_t * q, limb_t * r, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // q = a / b, r = a % b, na >= nb, b has non zero top limb, q is na-nb+1 limbs, r is nb limbs
+   int nq = na - nb + 1;
+   if (nb == 1)
+      r[0] = ldiv1 (q, a, na, b[0]);
+   else if (nb < LIMB_NEWTON || nq < LIMB_NEWTON)
+      ldiv_basic (q, r, a, na, b, nb);
+   else if (nq <= nb)
+      lnewton (q, r, a, na, b, nb);
+   else
+   {                            // Long quotient, do in blocks of nb-1 limbs from the top, so each step is balanced
+      int k = nb - 1;
+      limb_t *n = malloc ((nb + k + k + 1) * sizeof (*n));
+      if (!n)
+      {
+         ldiv_basic (q, r, a, na, b, nb);       // Less space
+         return;
+      }
+      limb_t *qt = n + nb + k;
+      memset (q, 0, nq * sizeof (*q));
+      memset (r, 0, nb * sizeof (*r));
+      int nr = 0;
+      for (int hi = na; hi > 0; hi -= k)
+      {
+         int lo = (hi > k ? hi - k : 0),
+            nn = hi - lo;
+         memcpy (n, a + lo, nn * sizeof (*n));
+         memcpy (n + nn, r, nr * sizeof (*n));
+         nn += nr;
+         while (nn && !n[nn - 1])
+            nn--;
+         if (nn < nb)
+         {                      // Quotient limbs all zero
+            memcpy (r, n, nn * sizeof (*r));
+            nr = nn;
+            continue;
+         }
+         ldivmod (qt, r, n, nn, b, nb);
+         if (lnomem)
+            break;
+         int nqt = nn - nb + 1; // Fits in the block as the remainder carried in is less than b
+         if (nqt > hi - lo)
+            nqt = hi - lo;
+         if (lo + nqt > nq)
+            nqt = nq - lo;
+         memcpy (q + lo, qt, nqt * sizeof (*q));
+         nr = nb;
+         while (nr && !r[nr - 1])
+            nr--;
+      }
+      memset (r + nr, 0, (nb - nr) * sizeof (*r));
+      free (n);
+   }
+}
+
+static int
+llincomb (limb_t * r, const limb_t * a, const limb_t * b, int n, int64_t x, int64_t y)
+{                               // r = a*x + b*y, over n limbs, x and y under 2^31, result known to be non negative, returns limbs
+   int64_t c = 0;
+   for (int i = 0; i < n; i++)
+   {
+      c += x * a[i] + y * b[i];
+      int64_t q = c / (int64_t) LIMB_BASE,
+         v = c - q * (int64_t) LIMB_BASE;
+      if (v < 0)
+      {
+         v += LIMB_BASE;
+         q--;
+      }
+      r[i] = v;
+      c = q;
+   }
+   while (n && !r[n - 1])
+      n--;
+   return n;
+}
+
+static int
+lgcd (limb_t * g, const limb_t * a, int na, const limb_t * b, int nb)
+{                               // g = GCD of a and b, g needs as many limbs as the longer, returns limbs (Lehmer, Knuth 4.5.2 algorithm L)
+   while (na && !a[na - 1])
+      na--;
+   while (nb && !b[nb - 1])
+      nb--;
+   int n = (na > nb ? na : nb) + 1;
+   limb_t *w = calloc (4 * n, sizeof (*w));
+   if (!w)
+   {                            // As if no common factor, which is still right, just not reduced
+      g[0] = 1;
+      return 1;
+   }
+   limb_t *x = w,
+      *y = x + n,
+      *t = y + n,
+      *u = t + n;
+   memcpy (x, a, na * sizeof (*x));
+   memcpy (y, b, nb * sizeof (*y));
+   int nx = na,
+      ny = nb;
+   void swap (limb_t ** p, limb_t ** q)
+   {
+      limb_t *s = *p;
+      *p = *q;
+      *q = s;
+   }
+   if (lcmp (x, nx, y, ny) < 0)
+   {
+      swap (&x, &y);
+      int s = nx;
+      nx = ny;
+      ny = s;
+   }
+   while (ny)
+   {                            // x >= y
+      if (nx <= 2)
+      {                         // Fits a word
+         uint64_t p = (nx > 1 ? (uint64_t) x[1] * LIMB_BASE : 0) + x[0],
+            q = (ny > 1 ? (uint64_t) y[1] * LIMB_BASE : 0) + y[0];
+         while (q)
+         {
+            uint64_t s = p % q;
+            p = q;
+            q = s;
+         }
+         x[0] = p % LIMB_BASE;
+         x[1] = p / LIMB_BASE;
+         nx = 1 + !!x[1];
+         break;
+      }
+      // Leading two limbs of each, at the same position
+      int64_t xh = (int64_t) x[nx - 1] * LIMB_BASE + x[nx - 2],
+         yh = (int64_t) y[nx - 1] * LIMB_BASE + y[nx - 2],
+         A = 1,
+         B = 0,
+         C = 0,
+         D = 1;
+      while (yh + C > 0 && yh + D > 0)
+      {
+         int64_t q = (xh + A) / (yh + C);
+         if (q != (xh + B) / (yh + D))
+            break;
+         int64_t c = A - q * C,
+            d = B - q * D;
+         if (c >= INT32_MAX || c <= -INT32_MAX || d >= INT32_MAX || d <= -INT32_MAX)
+            break;              // Keep the cosequence within a limb multiply
+         A = C;
+         C = c;
+         B = D;
+         D = d;
+         int64_t s = xh - q * yh;
+         xh = yh;
+         yh = s;
+      }
+      if (!B)
+      {                         // Full division step
+         ldivmod (u, t, x, nx, y, ny);
+         if (lnomem)
+         {                      // As if no common factor
+            lnomem = 0;
+            free (w);
+            g[0] = 1;
+            return 1;
+         }
+         memset (t + ny, 0, (n - ny) * sizeof (*t));
+         swap (&x, &y);
+         swap (&y, &t);
+         nx = ny;
+         while (ny && !y[ny - 1])
+            ny--;
+      } else
+      {                         // Apply the cosequence to the whole values
+         int nt = llincomb (t, x, y, nx, A, B),
+            nu = llincomb (u, x, y, nx, C, D);
+         swap (&x, &t);
+         swap (&y, &u);
+         nx = nt;
+         ny = nu;
+      }
+      if (lcmp (x, nx, y, ny) < 0)
+      {
+         swap (&x, &y);
+         int s = nx;
+         nx = ny;
+         ny = s;
+      }
+   }
+   memcpy (g, x, nx * sizeof (*g));
+   free (w);
+   return nx;
+}
+
+typedef struct
+{
+   sd_val_t *a;
+   sd_val_t *b;
+   unsigned char neg:1;
+   unsigned char a_free:1;
+   unsigned char b_free:1;
+} umul_t;
+#define umul(failp,...) umul_opts(failp,(umul_t){__VA_ARGS__})
+static sd_val_t *
+umul_opts (const char **failp, umul_t o)
+{                               // Unsigned mul (i.e. final sign already set in r) and set in r if needed
+   sd_val_t *a = o.a ? : &zero;
+   sd_val_t *b = o.b ? : &zero;
+   debugout ("umul", a, b, NULL);
+   sd_val_t *r = NULL;
+   if (!a->sig || !b->sig)
+      r = copy (failp, &zero);
+   else
+   {                            // Multiply as limbs
+      int na = limbs (a->sig),
+         nb = limbs (b->sig);
+      limb_t s[64],             // Small operands need no allocation
+       *l = 2 * (na + nb) <= sizeof (s) / sizeof (*s) ? s : malloc (2 * (na + nb) * sizeof (*l));
+      if (!l)
+      {
+         if (failp && !*failp)
+            *failp = "Malloc failed";
+      } else
+      {
+         limb_t *la = l,
+            *lb = la + na,
+            *lr = lb + nb;
+         tolimbs (a, a->mag - a->sig, la, na);
+         if (a == b)
+            lb = la;            // Square
+         else
+            tolimbs (b, b->mag - b->sig, lb, nb);
+         lmul (lr, la, na, lb, nb);
+         r = fromlimbs (failp, lr, na + nb, a->mag - a->sig + b->mag - b->sig + 1);
+         if (l != s)
+            free (l);
+      }
+   }
+   if (o.a_free)
+      freez (o.a);
+   if (o.b_free)
+      freez (o.b);
+ return norm (r, neg:o.neg);
+}
+
+static sd_val_t *
+saddto (const char **failp, sd_val_t * a, sd_val_t * b, int neg)
+{                               // Signed a += b (or -= if neg), reusing a, returns a (possibly moved) or NULL if failed leaving a as it was
+   if (!b->sig)
+      return a;
+   int bneg = !b->neg ^ !neg;     // Sign bits are signed bit fields
+   int mag = a->mag,
+      end = a->mag - a->sig;
+   if (!a->sig || b->mag > mag)
+      mag = b->mag;
+   if (!a->sig || b->mag - b->sig < end)
+      end = b->mag - b->sig;
+   if (!a->sig)
+      a->neg = bneg;
+   if (!(a = grow (failp, a, mag + 1, end, 1)))        // Extra digit for carry
+      return a;
+   char *p = a->d + a->mag - b->mag;
+   if (!a->neg == !bneg)
+   {
+      int c = kern->dadd (p, b->d, b->sig);
+      while (c)
+      {                         // Stops at the extra digit at worst
+         c = (++*--p == 10);
+         if (c)
+            *p = 0;
+      }
+   } else
+   {
+      int c = kern->dsub (p, b->d, b->sig);
+      while (c && p > a->d)
+      {
+         c = !*--p;
+         *p = (c ? 9 : *p - 1);
+      }
+      if (c)
+      {                         // b was bigger, ten's complement to get b-a and flip sign
+         for (int i = 0; i < a->sig; i++)
+            a->d[i] = 9 - a->d[i];
+         for (p = a->d + a->sig - 1; ++*p == 10; p--)
+            *p = 0;
+         a->neg ^= 1;
+      }
+   }
+   return norm (a);
+}
+
+static sd_val_t *
+smulby (const char **failp, sd_val_t * a, sd_val_t * b)
+{                               // Signed a *= b, reusing a, returns a (possibly moved) or NULL if failed leaving a as it was
+   if (!a->sig || !b->sig)
+   {
+      a->sig = 0;
+      return norm (a);
+   }
+   int na = limbs (a->sig),
+      nb = limbs (b->sig),
+      end = a->mag - a->sig + b->mag - b->sig + 1;
+   limb_t s[64],
+    *l = 2 * (na + nb) <= sizeof (s) / sizeof (*s) ? s : malloc (2 * (na + nb) * sizeof (*l));
+   if (!l)
+   {
+      if (failp && !*failp)
+         *failp = "Malloc failed";
+      return NULL;
+   }
+   limb_t *la = l,
+      *lb = la + na,
+      *lr = lb + nb;
+   tolimbs (a, a->mag - a->sig, la, na);
+   if (a == b)
+      lb = la;                  // Square
+   else
+      tolimbs (b, b->mag - b->sig, lb, nb);
+   lmul (lr, la, na, lb, nb);
+   int neg = b->neg,            // b may be a, which can move
+      n = na + nb;
+   while (n && !lr[n - 1])
+      n--;
+   sd_val_t *r = grow (failp, a, end + n * LIMB_DIGITS, end, 0);
+   if (r)
+   {
+      r->neg ^= neg;
+      char *d = r->d + r->sig;
+      for (int i = 0; i < n; i++)
+      {
+         limb_t v = lr[i];
+         for (int k = 0; k < LIMB_DIGITS; k++)
+         {
+            *--d = v % 10;
+            v /= 10;
+         }
+      }
+      norm (r);
+   }
+   if (l != s)
+      free (l);
+   return r;
+}
+
+static inline int
+roundup (sd_round_t round, int diff, int odd)
+{                               // If rounding away from zero, diff is remainder compared to half, odd is last digit kept, FLOOR/CEILING already swapped for negative
+   return round == SD_ROUND_UP ||       // Round up
+      round == SD_ROUND_CEILING // Round up
+      || (round == SD_ROUND_ROUND && diff >= 0) // Round up if 0.5 and above up
+      || (round == SD_ROUND_NI && diff > 0)     // Round up if above 0.5
+      || (round == SD_ROUND_BANKING && diff > 0)        // Round up if above 0.5
+      || (round == SD_ROUND_BANKING && !diff && odd);   // Round up if 0.5 and odd previous digit
+}
+
+#define	GCD_DIGITS	20      // Reduce rationals when the denominator has more digits than this
+#define	WORD_DIGITS	18      // Divisor digits for short division, so remainder*10+9 fits uint64_t
+
+struct sd_divisor_s
+{                               // Precomputed divisor, see sd_divisor
+   sd_val_t *b;                 // Divisor, the numerator of the value divided by
+   sd_val_t *d;                 // Denominator of the value divided by, multiplies each dividend, NULL if 1
+   sd_val_t *half;              // Half of b, for rounding
+   uint64_t top;                // Leading digits of b as a word, all of it if short division
+   int places;                  // Places of value divided by
+   int prec;                    // Precision context of value divided by
+   int precden;
+   sd_round_t precround;
+};
+
+static sd_val_t *
+uhalf (const char **failp, sd_val_t * b)
+{                               // Half of b, as 5b one place down
+   sd_val_t *half = make (failp, b->mag + 1, b->sig + 1);
+   if (half)
+   {
+      half->d[0] = kern->dmul1 (half->d + 1, b->d, b->sig, 5);
+      norm (half);
+   }
+   return half;
+}
+
+static uint64_t
+utop (sd_val_t * b)
+{                               // Leading digits of b, up to WORD_DIGITS, as a word
+   uint64_t top = 0;
+   for (int i = 0; i < WORD_DIGITS && i < b->sig; i++)
+      top = top * 10 + b->d[i];
+   return top;
+}
+
+typedef struct
+{
+   sd_val_t *a;
+   sd_val_t *b;
+   const struct sd_divisor_s *by;       // Precomputed b, used instead of b if set
+   sd_val_t **rem;
+   int places;
+   sd_round_t round;
+   unsigned char neg:1;         // Negative
+   unsigned char pad:1;         // Pad to specified places
+   unsigned char sig:1;         // Places is sig figures
    unsigned char a_free:1;
    unsigned char b_free:1;
 } udiv_t;
@@ -893,51 +2614,148 @@ static sd_val_t *
 udiv_opts (const char **failp, udiv_t o)
 {                               // Unsigned div (i.e. final sign already set in r) and set in r if needed
    sd_val_t *a = o.a ? : &zero;
-   sd_val_t *b = o.b ? : &zero;
+   sd_val_t *b = o.by ? o.by->b : o.b ? : &zero;
    sd_val_t *r = NULL;
    debugout ("udiv", a, b, NULL);
-   sd_val_t *base[9] = { };
    if (!b->sig)
    {
       if (failp && !*failp)
          *failp = "Division by zero";
    } else
    {
-      makebase (failp, base, b);
       int mag = a->mag - b->mag;
       int sig = mag + o.places + 1;     // Limit to places
       if (o.sig)
          sig = o.places;
       if (o.sig && ucmp (failp, a, b, mag) < 0)
          mag--;
+      int shift = mag - sig;    // Position below last digit of quotient
       if (sig < 0)
+      {                         // No digits, but still round at shift
+         mag = shift;
          sig = 0;
+      }
       r = make (failp, mag + 2, sig + 2);
-      r->d += 2;                // Allowed more space for the rounding in-situ, including allowing for round at end
-      r->mag -= 2;
-      r->sig -= 2;
       if (r)
       {
-         sd_val_t *v = make (failp, a->mag, b->sig + sig + 1);
+         r->d += 2;             // Allowed more space for the rounding in-situ, including allowing for round at end
+         r->mag -= 2;
+         r->sig -= 2;
+         sd_val_t *v = NULL;
+         int end = a->mag - a->sig;     // Position below lowest digit of remainder
+         if (b->mag - b->sig + shift + 1 < end)
+            end = b->mag - b->sig + shift + 1;
+         if (b->sig <= WORD_DIGITS)
+         {                      // Short division, divisor fits a word, running remainder
+            int digit (int p)
+            {                   // Digit of a at position p
+               return p <= a->mag && p > a->mag - a->sig ? a->d[a->mag - p] : 0;
+            }
+            uint64_t w = o.by ? o.by->top : utop (b),
+               rem = 0;
+            int at = b->mag - b->sig + 1 + mag + 1;     // Position of units of rem, b's last digit shifted to the quotient digit
+            for (int p = a->mag; p >= at; p--)
+               rem = rem * 10 + digit (p);      // Less than w, as quotient fits from mag
+            for (int p = mag; p > mag - sig; p--)
+            {
+               rem = rem * 10 + digit (--at);
+               r->d[mag - p] = rem / w;
+               rem %= w;
+               if (!o.pad && !rem && at <= a->mag - a->sig + 1)
+                  break;
+            }
+            int tail = at - (a->mag - a->sig + 1);      // Digits of a below at
+            if (tail < 0)
+               tail = 0;
+            v = make (failp, at + WORD_DIGITS - 1, WORD_DIGITS + tail);
+            if (v)
+            {
+               for (int i = WORD_DIGITS - 1; i >= 0; i--)
+               {
+                  v->d[i] = rem % 10;
+                  rem /= 10;
+               }
+               for (int i = 0; i < tail; i++)
+                  v->d[WORD_DIGITS + i] = digit (at - 1 - i);
+               norm (v);
+            }
+         } else if (sig >= LIMB_NEWTON * LIMB_DIGITS && b->sig >= LIMB_NEWTON * LIMB_DIGITS)
+         {                      // Large, quotient and remainder in one go as integers, b shifted to last digit of quotient
+            int na = limbs (a->mag - end),
+               nb = limbs (b->mag + shift + 1 - end);
+            limb_t *l = malloc ((2 * na + 2 * nb) * sizeof (*l));
+            if (!l)
+            {
+               if (failp && !*failp)
+                  *failp = "Malloc failed";
+            } else
+            {
+               limb_t *la = l,
+                  *lb = la + na,
+                  *lq = lb + nb,
+                  *lr = lq + na;
+               tolimbs (a, end, la, na);
+               tolimbs (b, end - shift - 1, lb, nb);
+               if (na < nb)
+                  v = copy (failp, a);
+               else
+                  ldivmod (lq, lr, la, na, lb, nb);
+               if (na >= nb && !lnomem_fail (failp))
+               {
+                  char *d = r->d + sig;
+                  for (int i = 0; i < na - nb + 1 && d > r->d; i++)
+                  {
+                     limb_t q = lq[i];
+                     for (int k = 0; k < LIMB_DIGITS && d > r->d; k++)
+                     {
+                        *--d = q % 10;
+                        q /= 10;
+                     }
+                  }
+                  v = fromlimbs (failp, lr, nb, end);
+               }
+               free (l);
+            }
+         } else
+         {                      // Long division a digit at a time, estimating each digit from the leading digits
+            v = make (failp, a->mag + 1, a->mag + 1 - end);     // Leading 0 as the remainder can have a digit above b
+            if (v)
+            {
+               memcpy (v->d + 1, a->d, a->sig);
+               uint64_t top = o.by ? o.by->top : utop (b);
+               for (int p = mag; p > mag - sig; p--)
+               {
+                  char *w = v->d + a->mag - b->mag - p;        // Remainder digits from a digit above b shifted to p
+                  uint64_t x = 0;
+                  for (int i = 0; i <= WORD_DIGITS; i++)
+                     x = x * 10 + w[i];
+                  int n = x / top;
+                  if (n > 9)
+                     n = 9;
+                  int t = w[0] - kern->dmul1sub (w + 1, b->d, b->sig, n);
+                  while (t < 0)
+                  {             // Estimate too high, add back
+                     t += kern->dadd (w + 1, b->d, b->sig);
+                     n--;
+                  }
+                  while (t || kern->dcmp (w + 1, b->d, b->sig) >= 0)
+                  {             // Estimate too low
+                     t -= kern->dsub (w + 1, b->d, b->sig);
+                     n++;
+                  }
+                  w[0] = t;
+                  r->d[mag - p] = n;
+                  if (!o.pad && w + 1 + b->sig - v->d >= a->sig + 1 && kern->dlead0 (w + 1, b->sig) == b->sig)
+                     break;     // Remainder is zero
+               }
+               norm (v);
+            }
+         }
          if (!v)
          {
-            free_base (base);
             freez (r);
             return v;
          }
-         memcpy (v->d, a->d, v->sig = a->sig);
-         for (int p = mag; p > mag - sig; p--)
-         {
-            int n = 0;
-            while (n < 9 && ucmp (failp, v, base[n], p) >= 0)
-               n++;
-            //debugout ("udiv rem", v, NULL);
-            if (n)
-             v = usub (failp, v, base[n - 1], boffset: p, a_free:1);
-            r->d[mag - p] = n;
-            if (!o.pad && !v->sig)
-               break;
-         }
          if (o.round != SD_ROUND_TRUNCATE && v->sig)
          {                      // Rounding
             if (!o.round)
@@ -949,27 +2767,24 @@ udiv_opts (const char **failp, udiv_t o)
                else if (o.round == SD_ROUND_CEILING)
                   o.round = SD_ROUND_FLOOR;
             }
-            int shift = mag - sig;
-            int diff = ucmp (failp, v, base[4], shift);
-            if (o.round == SD_ROUND_UP ||       // Round up
-                o.round == SD_ROUND_CEILING     // Round up
-                || (o.round == SD_ROUND_ROUND && diff >= 0)     // Round up if 0.5 and above up
-                || (o.round == SD_ROUND_NI && diff > 0) // Round up if above 0.5
-                || (o.round == SD_ROUND_BANKING && diff > 0)    // Round up if above 0.5
-                || (o.round == SD_ROUND_BANKING && !diff && (r->d[r->sig - 1] & 1))     // Round up if 0.5 and odd previous digit
-               )
+            sd_val_t *half = o.by ? o.by->half : uhalf (failp, b);
+            int diff = ucmp (failp, v, half, shift);
+            if (!o.by)
+               freez (half);
+            if (roundup (o.round, diff, r->d[r->sig - 1] & 1))
             {                   // Add one
                if (o.rem)
                {                // Adjust remainder, goes negative
-                  base[0]->mag += shift + 1;
-                  sd_val_t *s = usub (failp, base[0], v);
-                  base[0]->mag -= shift + 1;
+                  sd_val_t *u = copy (failp, b);
+                  u->mag += shift + 1;
+                  sd_val_t *s = usub (failp, u, v);
+                  freez (u);
                   freez (v);
                   v = s;
                   v->neg ^= 1;
                }
                // Adjust r
-             r = uadd (failp, r, &one, boffset: r->mag - r->sig + 1, a_free:1);
+             r = uadd (failp, r, &one, boffset: shift + 1, a_free:1);
                if (o.sig)
                   r->sig = sig;
             }
@@ -985,7 +2800,6 @@ udiv_opts (const char **failp, udiv_t o)
             freez (v);
       }
    }
-   free_base (base);
    if (o.a_free)
       freez (o.a);
    if (o.b_free)
@@ -1151,12 +2965,14 @@ srnd_opts (const char **failp, srnd_t o)
       int sig = a->sig - (decimals - o.places);
       if (a->sig < a->mag + 1)
          sig = a->mag + 1 - (decimals - o.places);
+      if (sig >= a->sig)
+         return copy (failp, a);        // No digits below the places, e.g. large integer with trailing zeros
       sd_val_t *r = NULL;
       if (sig <= 0)
       {
          r = z ();
-         if (sig < 0)
-            return r;
+         if (sig < 0 && o.round != SD_ROUND_UP && o.round != (a->neg ? SD_ROUND_FLOOR : SD_ROUND_CEILING))
+            return r;           // Below the rounding digit, so only rounding away from zero matters
          sig = 0;               // Allow rounding
       } else
       {
@@ -1180,8 +2996,7 @@ srnd_opts (const char **failp, srnd_t o)
          }
          if (o.round == SD_ROUND_CEILING || o.round == SD_ROUND_UP)
          {                      // Up (away from zero) if not exact
-            while (p < a->sig && !a->d[p])
-               p++;
+            p += kern->dlead0 (a->d + p, a->sig - p);
             if (p < a->sig)
                up = 1;          // not exact
          } else if (o.round == SD_ROUND_ROUND && a->d[p] >= 5)  // Up if .5 or above
@@ -1193,8 +3008,7 @@ srnd_opts (const char **failp, srnd_t o)
             else if (a->d[p] == 5)
             {                   // Check if exactly 0.5, if above then we round up
                p++;
-               while (p < a->sig && !a->d[p])
-                  p++;
+               p += kern->dlead0 (a->d + p, a->sig - p);
                if (p < a->sig)
                   up = 1;       // greater than .5
                else if (o.round != SD_ROUND_NI && a->d[sig - 1] & 1)
@@ -1202,10 +3016,12 @@ srnd_opts (const char **failp, srnd_t o)
             }
          }
          if (up)
-         {                      // Round up (away from 0)
-          sd_val_t *s = uadd (failp, r, &one, boffset:r->mag - r->sig + 1);
+         {                      // Round up (away from 0), a zero has no digits so round at places
+          sd_val_t *s = uadd (failp, r, &one, boffset:r->sig ? r->mag - r->sig + 1 : -o.places);
             freez (r);
             r = s;
+            if (o.sig && r->mag > a->mag)
+               o.places--;      // Carried to a new digit, so one less place for same sig figures
             decimals = r->sig - r->mag - 1;
             if (decimals < 0)
                decimals = 0;
@@ -1227,7 +3043,8 @@ srnd_opts (const char **failp, srnd_t o)
             }
          }
       }
-      r->neg = a->neg;
+      if (r->sig)
+         r->neg = a->neg;
       return r;
    }
    if (decimals < o.places)
@@ -1341,13 +3158,24 @@ stringdecimal_cmp_opts (stringdecimal_binary_t o)
 static sd_p
 sd_make (const char *failure)
 {                               // Make sd_p
-   sd_p v = calloc (1, sizeof (*v));
+   sd_p v = palloc ();
    if (!v)
       return v;
    v->failure = failure;
    return v;
 }
 
+static void
+precmerge (int *prec, int *precden, sd_round_t * round, int p, int pd, sd_round_t pr)
+{                               // Merge precision context p/pd/pr in to prec/precden/round, the tighter limit where both are set, 0 being none
+   int d = (*precden ? : *prec),
+      e = (pd ? : p);
+   *prec = (!*prec || (p && p < *prec) ? p : *prec);
+   *precden = (!d || (e && e < d) ? e : d);
+   if (!*round)
+      *round = pr;
+}
+
 static sd_p
 sd_new (sd_p l, sd_p r)
 {                               // Basic details for binary operator
@@ -1358,6 +3186,14 @@ sd_new (sd_p l, sd_p r)
       v->places = l->places;
    if (r && r->places > v->places)
       v->places = r->places;
+   if (l)
+   {
+      v->prec = l->prec;
+      v->precden = l->precden;
+      v->precround = l->precround;
+   }
+   if (r)
+      precmerge (&v->prec, &v->precden, &v->precround, r->prec, r->precden, r->precround);
    if (l && l->failure)
       v->failure = l->failure;
    if (r && r->failure && v->failure)
@@ -1392,9 +3228,68 @@ sd_rnd_opts (sd_rnd_t o)
    return r;
 }
 
+static void
+sd_reduce (sd_p v)
+{                               // Divide numerator and denominator by their GCD
+   sd_val_t *n = v->n,
+      *d = v->d;
+   int end = n->mag - n->sig;   // Position below last digit of either, so both are integers in limbs
+   if (d->mag - d->sig < end)
+      end = d->mag - d->sig;
+   int nn = limbs (n->mag - end),
+      nd = limbs (d->mag - end),
+      m = (nn > nd ? nn : nd);
+   limb_t *l = malloc ((nn + nd + 3 * m + 2) * sizeof (*l));
+   if (!l)
+      return;                   // Still right, just not reduced
+   limb_t *ln = l,
+      *ld = ln + nn,
+      *g = ld + nd,
+      *q = g + m,
+      *r = q + m + 1;
+   tolimbs (n, end, ln, nn);
+   tolimbs (d, end, ld, nd);
+   int ng = lgcd (g, ln, nn, ld, nd);
+   if (ng > 1 || g[0] > 1)
+   {
+      ldivmod (q, r, ln, nn, g, ng);
+      sd_val_t *rn = (lnomem_fail (NULL) ? NULL : fromlimbs (&v->failure, q, nn - ng + 1, end));
+      ldivmod (q, r, ld, nd, g, ng);
+      sd_val_t *rd = (lnomem_fail (NULL) ? NULL : fromlimbs (&v->failure, q, nd - ng + 1, end));
+      if (rn && rd)
+      {
+         rn->neg = n->neg;
+         v->n = rn;
+         v->d = rd;
+         freez (n);
+         freez (d);
+      } else
+      {                         // Still right, just not reduced
+         freez (rn);
+         freez (rd);
+      }
+   }
+   free (l);
+}
+
+static sd_p sd_tidy_reduced (sd_p v);
+
 static sd_p
 sd_tidy (sd_p v)
 {                               // Check answer
+   if (v && v->d && v->d->neg)
+   {                            // Normalise sign
+      v->n->neg ^= 1;
+      v->d->neg = 0;
+   }
+   if (v && v->n && v->n->sig && v->d && v->d->sig > GCD_DIGITS)
+      sd_reduce (v);            // Lazily, so rationals stay bounded without reducing every small one
+   return sd_tidy_reduced (v);
+}
+
+static sd_p
+sd_tidy_reduced (sd_p v)
+{                               // Check answer, already in lowest terms
    if (v && v->d && v->d->neg)
    {                            // Normalise sign
       v->n->neg ^= 1;
@@ -1405,6 +3300,75 @@ sd_tidy (sd_p v)
       v->n->mag -= v->d->mag;
       freez (v->d);
    }
+   if (v && v->n && v->n->sig && v->d && v->d->sig && v->d->sig <= 19)
+   {                            // 2^k or 5^k times power of 10 denominator, multiply by 5^k or 2^k to make it a power of 10
+      uint64_t x = 0;
+      for (int i = 0; i < v->d->sig; i++)
+         x = x * 10 + v->d->d[i];
+      int f = 0,
+         k = 0;
+      if (!(x & (x - 1)))
+         for (f = 5; x > 1; x >>= 1)
+            k++;
+      else if (!(x % 5))
+      {
+         for (; !(x % 5); x /= 5)
+            k++;
+         if (x == 1)
+            f = 2;
+      }
+      if (f)
+      {
+         limb_t m[6] = { 1 };   // 5^63 fits
+         int nm = 1;
+         for (int i = 0; i < k; i++)
+         {
+            uint64_t c = 0;
+            for (int j = 0; j < nm; j++)
+            {
+               c += (uint64_t) m[j] * f;
+               m[j] = c % LIMB_BASE;
+               c /= LIMB_BASE;
+            }
+            if (c)
+               m[nm++] = c;
+         }
+         sd_val_t *mv = fromlimbs (&v->failure, m, nm, -1);
+         sd_val_t *n = smul (&v->failure, v->n, mv);
+         freez (mv);
+         if (n)
+         {
+            n->mag -= k + v->d->mag - v->d->sig + 1;
+            freez (v->n);
+            freez (v->d);
+            v->n = n;
+         }
+      }
+   }
+   if (v && v->n && (v->prec || v->precden))
+   {                            // Precision context, round when over
+      int prec = v->prec ? : v->precden,
+         precden = v->precden ? : v->prec;
+      if (v->d && v->d->sig > precden)
+      {                         // Make decimal
+         sd_val_t *n = sdiv (&v->failure, v->n, v->d, places: prec, sig: 1, round:v->precround);
+         if (n)
+         {
+            freez (v->n);
+            freez (v->d);
+            v->n = n;
+         }
+      }
+      if (!v->d && v->n->sig > prec)
+      {
+         sd_val_t *n = srnd (&v->failure, v->n, places: prec, sig: 1, round:v->precround);
+         if (n)
+         {
+            freez (v->n);
+            v->n = n;
+         }
+      }
+   }
    if (v->n)
       checkmax (&v->failure, v->n->mag, v->n->sig);
    if (v->d)
@@ -1427,6 +3391,58 @@ sd_cross (sd_p l, sd_p r, sd_val_t ** ap, sd_val_t ** bp)
    return v;
 }
 
+static void
+cmp_lead (sd_val_t * a, uint64_t * lo, uint64_t * hi)
+{                               // Leading 9 digits of a, which is lo to hi times 10^(mag-8)
+   uint64_t v = 0;
+   for (int i = 0; i < 9; i++)
+      v = v * 10 + (i < a->sig ? a->d[i] : 0);
+   *lo = v;
+   *hi = v + (a->sig > 9);
+}
+
+static int
+cmp_quick (sd_p l, sd_p r, int abs)
+{                               // Compare without cross multiplying, -1, 0, 1, or 2 if not sure
+   sd_val_t *ln = l->n ? : &zero,
+      *ld = l->d ? : &one,
+      *rn = r->n ? : &zero,
+      *rd = r->d ? : &one;
+   if ((ln->sig && !*ln->d) || (ld->sig && !*ld->d) || (rn->sig && !*rn->d) || (rd->sig && !*rd->d))
+      return 2;                 // Not normalised, so mag is not reliable
+   int ls = !ln->sig ? 0 : ln->neg && !abs ? -1 : 1;
+   int rs = !rn->sig ? 0 : rn->neg && !abs ? -1 : 1;
+   if (ls != rs || !ls)
+      return ls < rs ? -1 : ls > rs ? 1 : 0;    // Signs differ, or both zero
+   // Same sign, compare magnitude, then flip if negative
+   int shift = (ln->mag - ld->mag) - (rn->mag - rd->mag);
+   if (shift > 1)
+      return ls;                // l at least 10 times r
+   if (shift < -1)
+      return -ls;               // r at least 10 times l
+   uint64_t lnlo,
+     lnhi,
+     ldlo,
+     ldhi,
+     rnlo,
+     rnhi,
+     rdlo,
+     rdhi;
+   cmp_lead (ln, &lnlo, &lnhi);
+   cmp_lead (ld, &ldlo, &ldhi);
+   cmp_lead (rn, &rnlo, &rnhi);
+   cmp_lead (rd, &rdlo, &rdhi);
+   uint64_t s = (shift > 0 ? 10 : 1),
+      t = (shift < 0 ? 10 : 1); // Products fit, under 10^19
+   if (lnhi * rdhi * s < rnlo * ldlo * t)
+      return -ls;               // l interval all below r
+   if (lnlo * rdlo * s > rnhi * ldhi * t)
+      return ls;                // l interval all above r
+   if (lnlo == lnhi && ldlo == ldhi && rnlo == rnhi && rdlo == rdhi)
+      return 0;                 // Exact, so equal
+   return 2;
+}
+
 sd_p
 sd_copy (sd_p p)
 {                               // Copy (create if p is NULL)
@@ -1437,6 +3453,9 @@ sd_copy (sd_p p)
       return v;
    v->failure = p->failure;
    v->places = p->places;
+   v->prec = p->prec;
+   v->precden = p->precden;
+   v->precround = p->precround;
    if (p->n)
       v->n = copy (&v->failure, p->n);
    if (p->d)
@@ -1444,6 +3463,21 @@ sd_copy (sd_p p)
    return v;
 }
 
+sd_p
+sd_prec_opts (sd_prec_t o)
+{                               // Set precision context, which carries through to results like places
+   if (!o.p)
+      return o.p;
+   if (!o.p_free)
+      o.p = sd_copy (o.p);
+   if (!o.p)
+      return o.p;
+   o.p->prec = o.prec;
+   o.p->precden = o.precden;
+   o.p->precround = o.round;
+   return sd_tidy (o.p);
+}
+
 sd_p
 sd_parse_opts (sd_parse_t o)
 {
@@ -1752,315 +3786,1902 @@ sd_output_opts (sd_output_opts_t o)
             freez (t);
             return r;
          }
-         break;
-      default:
-         warnx ("Unknown format %c\n", o.format);
-         break;
+         break;
+      default:
+         warnx ("Unknown format %c\n", o.format);
+         break;
+      }
+      return r;
+   }
+   char *r = format ();
+   if (!failp && p && p->failure)
+      failp = p->failure;
+   if (failp)
+   {
+      freez (r);
+      if (asprintf (&r, "!!%s", failp) < 0)
+         errx (1, "malloc");
+      if (o.failure)
+         *o.failure = "Output failed";
+   }
+   if (o.p_free)
+      sd_free (o.p);
+   return r;
+}
+
+sd_p
+sd_neg_opts (sd_1_t o)
+{                               // Negate
+   if (!o.p)
+      return o.p;
+   if (!o.p_free)
+      o.p = sd_copy (o.p);
+   if (o.p->n->sig)
+      o.p->n->neg ^= 1;
+   return o.p;
+}
+
+sd_p
+sd_abs_opts (sd_1_t o)
+{                               // Absolute
+   if (!o.p)
+      return o.p;
+   if (!o.p_free)
+      o.p = sd_copy (o.p);
+   o.p->n->neg = 0;
+   if (o.p->d)
+      o.p->d->neg = 0;
+   return o.p;
+}
+
+sd_p
+sd_inv_opts (sd_1_t o)
+{                               // Reciprocal
+   if (!o.p)
+      return o.p;
+   if (!o.p_free)
+      o.p = sd_copy (o.p);
+   sd_val_t *d = o.p->d;
+   if (!d)
+      d = copy (&o.p->failure, &one);
+   o.p->d = o.p->n;
+   o.p->n = d;
+   return o.p;
+}
+
+sd_p
+sd_10_opts (sd_10_t o)
+{                               // Adjust by power of 10
+   if (!o.p)
+      return o.p;
+   if (!o.p_free)
+      o.p = sd_copy (o.p);
+   if (!o.p->n)
+      return o.p;
+   o.p->n->mag += o.shift;
+   return o.p;
+}
+
+int
+sd_iszero (sd_p p)
+{                               // Is zero
+   return !p || !p->n || !p->n->sig;
+}
+
+int
+sd_isneg (sd_p p)
+{                               // Is negative (denominator always positive)
+   return p && p->n && p->n->neg;
+}
+
+int
+sd_ispos (sd_p p)
+{                               // Is positive (denominator always positive)
+   return p && p->n && p->n->sig && !p->n->neg;
+}
+
+static void
+sd_rational (sd_p p)
+{                               // Normalise to integers
+   if (!p || !p->n)
+      return;
+   if (!p->d)
+      p->d = copy (&p->failure, &one);
+   int s,
+     shift = p->n->sig - p->n->mag - 1;
+   if ((s = p->d->sig - p->d->mag - 1) > shift)
+      shift = s;
+   p->n->mag += shift;
+   p->d->mag += shift;
+}
+
+#ifdef	__SIZEOF_INT128__
+typedef __int128 word_t;
+#define	WORD_MAX	36      // Digits held as a word, leaving room for a sum or doubling
+#else
+typedef int64_t word_t;
+#define	WORD_MAX	18
+#endif
+
+static int
+toword (sd_val_t * a, int end, word_t * w)
+{                               // a as integer with units at position end+1, 0 if too many digits
+   if (a->sig && a->mag - end > WORD_MAX)
+      return 0;
+   word_t v = 0;
+   for (int i = 0; i < a->sig; i++)
+      v = v * 10 + a->d[i];
+   for (int p = a->mag - a->sig; p > end; p--)
+      v *= 10;
+   *w = (a->neg ? -v : v);
+   return 1;
+}
+
+static sd_val_t *
+fromword (const char **failp, word_t w, int end)
+{                               // Value from integer with units at position end+1
+   char neg = (w < 0);
+   if (neg)
+      w = -w;
+   char t[WORD_MAX + 3];        // Digits, least significant first
+   int n = 0;
+   while (w)
+   {                            // 18 digits at a time, as dividing a whole word is slow
+      uint64_t p = w % 1000000000000000000LL;
+      w /= 1000000000000000000LL;
+      for (int i = 0; i < 18 && (p || w); i++)
+      {
+         t[n++] = p % 10;
+         p /= 10;
+      }
+   }
+   sd_val_t *r = make (failp, end + n, n);
+   if (!r)
+      return r;
+   for (int i = 0; i < n; i++)
+      r->d[i] = t[n - 1 - i];
+ return norm (r, neg:neg);
+}
+
+static sd_p
+sd_word (sd_p l, sd_p r, char op, sd_round_t round)
+{                               // Add, subtract, multiply or modulo of small non rational values as words, NULL if not possible
+   if (!l || !r || l->d || r->d || !l->n || !r->n)
+      return NULL;
+   sd_val_t *a = l->n,
+      *b = r->n;
+   word_t x,
+     y;
+   int end;
+   if (op == '*')
+   {
+      if (a->sig + b->sig > WORD_MAX)
+         return NULL;
+      toword (a, a->mag - a->sig, &x);
+      toword (b, b->mag - b->sig, &y);
+      x *= y;
+      end = a->mag - a->sig + b->mag - b->sig + 1;
+   } else
+   {                            // Aligned
+      end = INT_MAX;
+      if (a->sig)
+         end = a->mag - a->sig;
+      if (b->sig && b->mag - b->sig < end)
+         end = b->mag - b->sig;
+      if (end == INT_MAX)
+         end = 0;
+      if (!toword (a, end, &x) || !toword (b, end, &y))
+         return NULL;
+      if (op == '+')
+         x += y;
+      else if (op == '-')
+         x -= y;
+      else if (!y)
+         return NULL;           // Let the full path report division by zero
+      else
+      {                         // Modulo, remainder takes sign of x unless quotient rounded away from zero
+         word_t m = x % y,
+            ay = (y < 0 ? -y : y),
+            am = (m < 0 ? -m : m),
+            q = x / y;
+         if (m)
+         {
+            if ((x < 0) != (y < 0))
+            {                   // reverse logic for +/-
+               if (round == SD_ROUND_FLOOR)
+                  round = SD_ROUND_CEILING;
+               else if (round == SD_ROUND_CEILING)
+                  round = SD_ROUND_FLOOR;
+            }
+            if (roundup (round, (am * 2 > ay) - (am * 2 < ay), (q & 1) != 0))
+               m = (m > 0 ? m - ay : m + ay);
+         }
+         x = m;
+      }
+   }
+   sd_p v = sd_new (l, r);
+   if (!v)
+      return v;
+   v->n = fromword (&v->failure, x, end);
+   return sd_tidy (v);
+}
+
+static sd_p
+sd_addsub (sd_p l, sd_p r, int sub)
+{                               // Add or subtract, over the common denominator, l and r not changed
+   sd_val_t *a,
+    *b;
+   sd_p v = sd_cross (l, r, &a, &b);
+   if (v)
+   {
+      v->n = (sub ? ssub : sadd) (&v->failure, a ? : l->n, b ? : r->n);
+      if (l->d || r->d)
+      {
+         if (!scmp (&v->failure, l->d ? : &one, r->d ? : &one))
+            v->d = copy (&v->failure, l->d ? : &one);
+         else
+            v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
+      }
+      freez (a);
+      freez (b);
+   }
+   return sd_tidy (v);
+}
+
+sd_p
+sd_add_opts (sd_2_t o)
+{                               // Add
+   sd_p l = o.l ? : &sd_zero;
+   sd_p r = o.r ? : &sd_zero;
+   sd_debugout ("sd_add", l, r, NULL);
+   sd_p v = sd_word (l, r, '+', 0);
+   if (!v)
+      v = sd_addsub (l, r, 0);
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return v;
+};
+
+sd_p
+sd_sub_opts (sd_2_t o)
+{                               // Subtract
+   sd_p l = o.l ? : &sd_zero;
+   sd_p r = o.r ? : &sd_zero;
+   sd_debugout ("sd_sub", l, r, NULL);
+   sd_p v = sd_word (l, r, '-', 0);
+   if (!v)
+      v = sd_addsub (l, r, 1);
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return v;
+};
+
+sd_p
+sd_mul_opts (sd_2_t o)
+{                               // Multiply
+   sd_p v = NULL;
+   if (o.l && o.r)
+   {                            // either being null means answer is null, as null is seen as zero
+      sd_p l = o.l;
+      sd_p r = o.r;
+      sd_debugout ("sd_mul", l, r, NULL);
+      v = sd_word (l, r, '*', 0);
+      if (!v)
+      {
+         v = sd_new (l, r);
+         if (r->d && !scmp (&v->failure, l->n, r->d))
+         {                      // Cancel out
+            v->n = copy (&v->failure, r->n);
+            v->d = copy (&v->failure, l->d);
+            if (l->n->neg)
+               v->n->neg ^= 1;
+         } else if (l->d && !scmp (&v->failure, r->n, l->d))
+         {                      // Cancel out
+            v->n = copy (&v->failure, l->n);
+            v->d = copy (&v->failure, r->d);
+            if (r->n->neg)
+               v->n->neg ^= 1;
+         } else
+         {                      // Multiple
+            if (l->d || r->d)
+               v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
+            v->n = smul (&v->failure, l->n, r->n);
+         }
+         v = sd_tidy (v);
+      }
+   }
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return v;
+};
+
+static sd_p
+sd_replace (sd_p * accp, sd_p v)
+{                               // Replace *accp with v, for in place operations falling back to the normal ones
+   sd_free (*accp);
+   return *accp = v;
+}
+
+static sd_p
+sd_in_place (sd_p * accp, sd_p x)
+{                               // Set up for in place operation, making *accp if NULL, merging places, precision context and failure as sd_new does
+   if (!*accp && !(*accp = sd_copy (NULL)))
+      return NULL;
+   sd_p acc = *accp;
+   if (!acc->n && !(acc->n = copy (&acc->failure, &zero)))
+      return NULL;
+   if (x)
+   {
+      if (x->places > acc->places)
+         acc->places = x->places;
+      precmerge (&acc->prec, &acc->precden, &acc->precround, x->prec, x->precden, x->precround);
+      if (x->failure && !acc->failure)
+         acc->failure = x->failure;
+   }
+   return acc;
+}
+
+sd_p
+sd_add_to (sd_p * accp, sd_p x)
+{                               // *accp += x, reusing the space of *accp
+   sd_p acc = sd_in_place (accp, x);
+   if (!acc || !x || !x->n)
+      return acc;
+   if (acc->d || x->d || acc == x)
+      return sd_replace (accp, sd_add (acc, x));
+   sd_val_t *n = saddto (&acc->failure, acc->n, x->n, 0);
+   if (n)
+      acc->n = n;
+   return sd_tidy (acc);
+}
+
+sd_p
+sd_sub_from (sd_p * accp, sd_p x)
+{                               // *accp -= x, reusing the space of *accp
+   sd_p acc = sd_in_place (accp, x);
+   if (!acc || !x || !x->n)
+      return acc;
+   if (acc->d || x->d || acc == x)
+      return sd_replace (accp, sd_sub (acc, x));
+   sd_val_t *n = saddto (&acc->failure, acc->n, x->n, 1);
+   if (n)
+      acc->n = n;
+   return sd_tidy (acc);
+}
+
+sd_p
+sd_mul_by (sd_p * accp, sd_p x)
+{                               // *accp *= x, reusing the space of *accp
+   sd_p acc = sd_in_place (accp, x);
+   if (!acc)
+      return acc;
+   if (!x || !x->n)
+      x = &sd_zero;
+   if (acc->d || x->d)
+      return sd_replace (accp, sd_mul (acc, x));
+   sd_val_t *n = smulby (&acc->failure, acc->n, x->n);
+   if (n)
+      acc->n = n;
+   return sd_tidy (acc);
+}
+
+sd_p
+sd_neg_in_place (sd_p p)
+{                               // Negate p, flipping its sign
+   if (p && p->n && p->n->sig)
+      p->n->neg ^= 1;
+   return p;
+}
+
+sd_p
+sd_abs_in_place (sd_p p)
+{                               // Absolute p, clearing its signs
+   if (p && p->n && p->n->neg)
+      p->n->neg = 0;
+   if (p && p->d && p->d->neg)
+      p->d->neg = 0;
+   return p;
+}
+
+// Accumulator, limbs summed without carrying so each add is one pass over the value's digits
+
+#define	ACC_ADDS	(1U<<30)        // Adds before carry is needed, each limb sum staying well within int64_t
+
+struct sd_acc_s
+{
+   int64_t *l;                  // Limbs, least significant first, not carried, may be negative
+   int n;                       // Limbs in use
+   int max;                     // Limbs allocated
+   int end;                     // Position below first limb, multiple of LIMB_DIGITS
+   unsigned int adds;           // Adds since last carried
+   sd_val_t *den;               // Common denominator (NULL for 1)
+   int places;                  // Max places of operands
+   int prec;                    // Precision context of operands, merged as sd_new does, applied to the total
+   int precden;
+   sd_round_t precround;
+   const char *failure;         // First failure
+};
+
+sd_acc_t *
+sd_acc_new (void)
+{
+   return calloc (1, sizeof (sd_acc_t));
+}
+
+void *
+sd_acc_free (sd_acc_t * a)
+{
+   if (a)
+   {
+      free (a->l);
+      freez (a->den);
+      free (a);
+   }
+   return NULL;
+}
+
+static void
+acc_carry (sd_acc_t * a)
+{                               // Carry, so limbs are 0 to LIMB_BASE-1 except the top which holds the sign
+   int64_t c = 0;
+   for (int i = 0; i < a->n; i++)
+   {
+      int64_t t = a->l[i] + c;
+      c = t / LIMB_BASE;
+      t %= LIMB_BASE;
+      if (t < 0)
+      {
+         t += LIMB_BASE;
+         c--;
+      }
+      a->l[i] = t;
+   }
+   if (c)
+   {                            // Top is below LIMB_BASE limbs at most, as each limb sum was below 2^63
+      if (a->n + 2 > a->max)
+      {
+         int64_t *l = realloc (a->l, (a->n + 2) * sizeof (*a->l));
+         if (!l)
+         {
+            if (!a->failure)
+               a->failure = "Malloc failed";
+            return;
+         }
+         a->l = l;
+         a->max = a->n + 2;
       }
-      return r;
+      if (c <= -(int64_t) LIMB_BASE || c >= (int64_t) LIMB_BASE)
+      {
+         a->l[a->n++] = c % LIMB_BASE;
+         c /= LIMB_BASE;
+         if (a->l[a->n - 1] < 0)
+         {
+            a->l[a->n - 1] += LIMB_BASE;
+            c--;
+         }
+      }
+      a->l[a->n++] = c;
    }
-   char *r = format ();
-   if (!failp && p && p->failure)
-      failp = p->failure;
-   if (failp)
+   while (a->n && !a->l[a->n - 1])
+      a->n--;
+   a->adds = 0;
+}
+
+static inline int
+acc_floor (int p)
+{                               // Round position down to a multiple of LIMB_DIGITS
+   return (p >= 0 ? p : p - (LIMB_DIGITS - 1)) / LIMB_DIGITS * LIMB_DIGITS;
+}
+
+static int
+acc_span (sd_acc_t * a, int e, int mag)
+{                               // Make limbs cover positions e+1 to mag, e a multiple of LIMB_DIGITS, non zero if no memory
+   if (a->adds++ == ACC_ADDS)
+      acc_carry (a);
+   if (!a->n)
+      a->end = e;
+   int below = (a->end - e) / LIMB_DIGITS;      // Limbs to add below
+   if (below < 0)
+      below = 0;
+   int top = (mag - a->end + below * LIMB_DIGITS - 1) / LIMB_DIGITS + 1;        // Limbs needed
+   if (top < a->n + below)
+      top = a->n + below;
+   if (top > a->max)
+   {                            // Grow, doubling
+      int max = (top > a->max * 2 ? top : a->max * 2);
+      int64_t *l = realloc (a->l, max * sizeof (*a->l));
+      if (!l)
+      {
+         if (!a->failure)
+            a->failure = "Malloc failed";
+         return 1;
+      }
+      a->l = l;
+      a->max = max;
+   }
+   if (below)
+   {                            // Move up
+      memmove (a->l + below, a->l, a->n * sizeof (*a->l));
+      memset (a->l, 0, below * sizeof (*a->l));
+      a->end -= below * LIMB_DIGITS;
+   }
+   if (top > a->n + below)
+      memset (a->l + a->n + below, 0, (top - a->n - below) * sizeof (*a->l));
+   a->n = top;
+   return 0;
+}
+
+static void
+acc_val (sd_acc_t * a, sd_val_t * v, int neg)
+{                               // Add v (negated if neg) on to the limbs, no carry
+   if (!v || !v->sig)
+      return;
+   if (v->neg)
+      neg = !neg;
+   if (acc_span (a, acc_floor (v->mag - v->sig), v->mag))
+      return;
+   for (int i = v->sig - 1; i >= 0;)
+   {                            // Last digit up, a limb at a time
+      int o = v->mag - i - a->end - 1,
+         k = o % LIMB_DIGITS;
+      int64_t x = 0;
+      for (; k < LIMB_DIGITS && i >= 0; k++, i--)
+         x += v->d[i] * limb_pow10[k];
+      a->l[o / LIMB_DIGITS] += (neg ? -x : x);
+   }
+}
+
+static void
+acc_mul (sd_acc_t * a, sd_val_t * x, sd_val_t * y, int neg)
+{                               // Add x*y (negated if neg) on to the limbs, multiplied as limbs aligned to the accumulator
+   if (!x->sig || !y->sig)
+      return;
+   if (!x->neg != !y->neg)
+      neg = !neg;
+   int ex = x->mag - x->sig,
+      ey = y->mag - y->sig,
+      e = acc_floor (ex + ey + 1);
+   ex -= ex + ey + 1 - e;       // Low zeros on x so product limbs line up
+   int nx = limbs (x->mag - ex),
+      ny = limbs (y->sig);
+   limb_t s[64],
+    *l = 2 * (nx + ny) <= sizeof (s) / sizeof (*s) ? s : malloc (2 * (nx + ny) * sizeof (*l));
+   if (!l)
    {
-      freez (r);
-      if (asprintf (&r, "!!%s", failp) < 0)
-         errx (1, "malloc");
-      if (o.failure)
-         *o.failure = "Output failed";
+      if (!a->failure)
+         a->failure = "Malloc failed";
+      return;
+   }
+   limb_t *lx = l,
+      *ly = lx + nx,
+      *lr = ly + ny;
+   tolimbs (x, ex, lx, nx);
+   tolimbs (y, ey, ly, ny);
+   lmul (lr, lx, nx, ly, ny);
+   int n = nx + ny;
+   while (n && !lr[n - 1])
+      n--;
+   if (!acc_span (a, e, e + n * LIMB_DIGITS))
+   {
+      int64_t *r = a->l + (e - a->end) / LIMB_DIGITS;
+      for (int i = 0; i < n; i++)
+         r[i] += (neg ? -(int64_t) lr[i] : lr[i]);
+   }
+   if (l != s)
+      free (l);
+}
+
+static void acc_fold (sd_acc_t * a, sd_p x, int neg);
+
+static void
+acc_context (sd_acc_t * a, sd_p x)
+{                               // Merge places, precision context and failure of an operand
+   if (x->places > a->places)
+      a->places = x->places;
+   precmerge (&a->prec, &a->precden, &a->precround, x->prec, x->precden, x->precround);
+   if (x->failure && !a->failure)
+      a->failure = x->failure;
+}
+
+static void
+acc_add (sd_acc_t * a, sd_p x, int neg)
+{                               // Add x, over the common denominator
+   if (!x)
+      return;
+   acc_context (a, x);
+   if (!x->n)
+      return;                   // Failed, or seen as zero
+   if (!a->den && x->d && !a->n)
+      a->den = copy (&a->failure, x->d);        // First denominator becomes the common one
+   if (!x->d && !a->den)
+      acc_val (a, x->n, neg);
+   else if (x->d && a->den && !ucmp (&a->failure, x->d, a->den, 0))
+      acc_val (a, x->n, neg);   // Same denominator
+   else
+   {                            // Scale up if common denominator is a multiple, else fold in with sd_add
+      sd_val_t *rem = NULL,
+         *q = NULL;
+      if (!x->d)
+         q = copy (&a->failure, a->den);        // Whole multiple
+      else
+         q = udiv (&a->failure, a->den ? : &one, x->d, rem: &rem, round:SD_ROUND_TRUNCATE);
+      if (q && (!rem || !rem->sig))
+      {
+         sd_val_t *m = umul (&a->failure, x->n, q, neg:x->n->neg);
+         acc_val (a, m, neg);
+         freez (m);
+      } else
+         acc_fold (a, x, neg);
+      freez (q);
+      freez (rem);
+   }
+}
+
+sd_p
+sd_acc_get (sd_acc_t * a)
+{                               // Total so far
+   if (!a)
+      return NULL;
+   sd_p v = sd_make (a->failure);
+   if (!v)
+      return v;
+   v->places = a->places;
+   v->prec = a->prec;
+   v->precden = a->precden;
+   v->precround = a->precround;
+   acc_carry (a);
+   int neg = (a->n && a->l[a->n - 1] < 0);
+   if (neg)
+   {                            // Negative, carry the negated limbs
+      for (int i = 0; i < a->n; i++)
+         a->l[i] = -a->l[i];
+      acc_carry (a);
+   }
+   limb_t *l = calloc (a->n + 1, sizeof (*l));
+   if (l)
+   {
+      for (int i = 0; i < a->n; i++)
+         l[i] = a->l[i];
+      v->n = fromlimbs (&v->failure, l, a->n, a->end);
+      free (l);
+   } else if (!v->failure)
+      v->failure = "Malloc failed";
+   if (a->failure && !v->failure)
+      v->failure = a->failure;  // Carry could not grow
+   if (neg)
+   {
+      if (v->n)
+         v->n->neg = 1;
+      for (int i = 0; i < a->n; i++)
+         a->l[i] = -a->l[i];
+   }
+   if (a->den)
+      v->d = copy (&v->failure, a->den);
+   return sd_tidy (v);
+}
+
+static void
+acc_fold (sd_acc_t * a, sd_p x, int neg)
+{                               // Add x by making the total and using sd_add, the new denominator becoming the common one
+   sd_p t = sd_acc_get (a);
+   t = (neg ? sd_sub_fc (t, x) : sd_add_fc (t, x));
+   a->n = 0;
+   freez (a->den);
+   if (t)
+   {
+      if (t->d)
+         a->den = copy (&a->failure, t->d);
+      acc_val (a, t->n, 0);
+      if (t->failure && !a->failure)
+         a->failure = t->failure;
+   }
+   sd_free (t);
+}
+
+static void
+acc_add_mul (sd_acc_t * a, sd_p x, sd_p y, int neg)
+{                               // Add x*y
+   if (!x || !x->n || !y || !y->n)
+      return;
+   if (x->d || y->d || a->den)
+   {                            // Rational, as a product
+      sd_p t = sd_mul (x, y);
+      acc_add (a, t, neg);
+      sd_free (t);
+      return;
    }
+   acc_context (a, x);
+   acc_context (a, y);
+   acc_mul (a, x->n, y->n, neg);
+}
+
+void
+sd_acc_add_opts (sd_acc_add_t o)
+{                               // Add to accumulator
+   if (o.a && o.m)
+      acc_add_mul (o.a, o.p, o.m, o.sub);
+   else if (o.a)                // NULL if sd_acc_new failed
+      acc_add (o.a, o.p, o.sub);
    if (o.p_free)
       sd_free (o.p);
-   return r;
+   if (o.m_free)
+      sd_free (o.m);
 }
 
 sd_p
-sd_neg_opts (sd_1_t o)
-{                               // Negate
-   if (!o.p)
-      return o.p;
-   if (!o.p_free)
-      o.p = sd_copy (o.p);
-   if (o.p->n->sig)
-      o.p->n->neg ^= 1;
-   return o.p;
+sd_fma_opts (sd_fma_t o)
+{                               // a*b+c, the product going straight in to the sum
+   sd_acc_t acc = { };
+   acc_add (&acc, o.c, 0);
+   acc_add_mul (&acc, o.a, o.b, 0);
+   sd_p v = sd_acc_get (&acc);
+   free (acc.l);
+   freez (acc.den);
+   if (o.a_free)
+      sd_free (o.a);
+   if (o.b_free)
+      sd_free (o.b);
+   if (o.c_free)
+      sd_free (o.c);
+   return v;
 }
 
 sd_p
-sd_abs_opts (sd_1_t o)
-{                               // Absolute
-   if (!o.p)
-      return o.p;
-   if (!o.p_free)
-      o.p = sd_copy (o.p);
-   o.p->n->neg = 0;
-   if (o.p->d)
-      o.p->d->neg = 0;
-   return o.p;
+sd_dot_opts (sd_dot_t o)
+{                               // Sum of a[i]*b[i], products going straight in to the sum
+   sd_acc_t acc = { };
+   for (int i = 0; i < o.n; i++)
+      acc_add_mul (&acc, o.a[i], o.b[i], 0);
+   sd_p v = sd_acc_get (&acc);
+   free (acc.l);
+   freez (acc.den);
+   return v;
+}
+
+void
+sd_acc_merge (sd_acc_t * a, sd_acc_t * b)
+{                               // Add total of b in to a, exact so the same total whatever order shards are merged
+   if (!b->n)
+   {
+      if (b->places > a->places)
+         a->places = b->places;
+      precmerge (&a->prec, &a->precden, &a->precround, b->prec, b->precden, b->precround);
+      if (b->failure && !a->failure)
+         a->failure = b->failure;
+      return;
+   }
+   sd_p t = sd_acc_get (b);
+   acc_add (a, t, 0);
+   sd_free (t);
 }
 
 sd_p
-sd_inv_opts (sd_1_t o)
-{                               // Reciprocal
-   if (!o.p)
-      return o.p;
-   if (!o.p_free)
-      o.p = sd_copy (o.p);
-   sd_val_t *d = o.p->d;
-   if (!d)
-      d = copy (&o.p->failure, &one);
-   o.p->d = o.p->n;
-   o.p->n = d;
-   return o.p;
+sd_product_opts (sd_n_t o)
+{                               // Multiply as a balanced tree, so operand sizes stay matched as they grow
+   if (o.n <= 0)
+      return sd_int (1);
+   sd_p *t = malloc (o.n * sizeof (*t));
+   if (!t)
+   {                            // No space for the tree, multiply in turn
+      sd_p v = (o.p_free ? o.p[0] : sd_copy (o.p[0]));
+      for (int i = 1; i < o.n; i++)
+       v = sd_mul_opts ((sd_2_t){v, o.p[i], l_free: 1, r_free:o.p_free});
+      return v;
+   }
+   memcpy (t, o.p, o.n * sizeof (*t));
+   int n = o.n,
+      own = o.p_free;           // If t[] are ours to free
+   while (n > 1 || !own)
+   {
+      int i;
+      for (i = 0; i + 1 < n; i += 2)
+       t[i / 2] = sd_mul_opts ((sd_2_t){t[i], t[i + 1], l_free: own, r_free:own});
+      if (i < n)
+         t[i / 2] = (own ? t[i] : sd_copy (t[i]));
+      n = (n + 1) / 2;
+      own = 1;
+   }
+   sd_p v = t[0];
+   free (t);
+   return v;
 }
 
 sd_p
-sd_10_opts (sd_10_t o)
-{                               // Adjust by power of 10
-   if (!o.p)
-      return o.p;
-   if (!o.p_free)
-      o.p = sd_copy (o.p);
-   if (!o.p->n)
-      return o.p;
-   o.p->n->mag += o.shift;
-   return o.p;
+sd_div_opts (sd_2_t o)
+{                               // Divide
+   sd_p v = NULL;
+   if (o.l && o.r)
+   {                            // either being null means answer is null, as null is seen as zero
+      sd_p l = o.l;
+      sd_p r = o.r;
+      sd_debugout ("sd_div", l, r, NULL);
+      if (!l->d && !r->d)
+      {                         // Simple - making a new rational
+         v = sd_new (l, r);
+         v->n = copy (&v->failure, l->n);
+         v->d = copy (&v->failure, r->n);
+         v = sd_tidy (v);
+      } else
+      {                         // Flip and multiply 
+         if (!o.r_free)
+         {                      // Copy as we are not freeing
+            o.r = r = sd_copy (r);
+            o.r_free = 1;
+         }
+         sd_val_t *t = r->n;
+         r->n = r->d ? : copy (&v->failure, &one);
+         r->d = t;
+         r->n->neg = r->d->neg;
+         r->d->neg = 0;
+         v = sd_mul (l, r);
+      }
+   }
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return v;
+};
+
+static sd_p
+sd_divmod_rem (sd_p l, sd_p r, sd_round_t round, sd_p * qp)
+{                               // Remainder, and integer quotient in *qp if not NULL, from one division
+   if (qp)
+      *qp = NULL;
+   sd_p v = sd_new (l, r);
+   if (!v)
+      return v;
+   if ((l->d && !l->d->sig) || (r->d && !r->d->sig) || !r->n->sig)
+   {                            // Infinite or zero divisor, before dividing by a zero
+      v->failure = "Division by zero";
+      return v;
+   }
+   sd_val_t *ad = smul (&v->failure, l->n, r->d ? : &one);
+   sd_val_t *bc = smul (&v->failure, l->d ? : &one, r->n);
+   if (l->d || r->d)
+      v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
+ sd_val_t *n = sdiv (&v->failure, ad, bc, rem: &v->n, round:round ? : SD_ROUND_FLOOR);
+   freez (ad);
+   freez (bc);
+   if (qp)
+   {
+      sd_p q = sd_new (l, r);
+      if (q)
+      {
+         q->places = 0;
+         q->n = n;
+         if (!q->failure)
+            q->failure = v->failure;
+         *qp = sd_tidy (q);
+      } else
+         freez (n);
+   } else
+      freez (n);
+   return sd_tidy (v);
 }
 
-int
-sd_iszero (sd_p p)
-{                               // Is zero
-   return !p || !p->n || !p->n->sig;
+sd_p
+sd_mod_opts (sd_mod_t o)
+{                               // modulo
+   sd_p v = NULL;
+   if (o.l && o.r)
+   {                            // either being null means answer is null, as null is seen as zero
+      sd_p l = o.l;
+      sd_p r = o.r;
+      sd_debugout ("sd_mod", l, r, NULL);
+      v = sd_word (l, r, '%', o.round ? : SD_ROUND_FLOOR);
+      if (!v)
+         v = sd_divmod_rem (l, r, o.round, NULL);
+   }
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return v;
 }
 
-int
-sd_isneg (sd_p p)
-{                               // Is negative (denominator always positive)
-   return p && p->n && p->n->neg;
+const char *
+sd_divmod_opts (sd_divmod_t o)
+{                               // Quotient and remainder
+   const char *failure = NULL;
+   sd_p q = NULL,
+      rem = NULL;
+   if (o.l && o.r)
+   {                            // either being null means answer is null, as null is seen as zero
+      sd_debugout ("sd_divmod", o.l, o.r, NULL);
+      rem = sd_divmod_rem (o.l, o.r, o.round, &q);
+      failure = (rem ? rem->failure : "Malloc failed");
+   } else
+      failure = "Null";
+   if (o.q)
+      *o.q = q;
+   else
+      sd_free (q);
+   if (o.rem)
+      *o.rem = rem;
+   else
+      sd_free (rem);
+   if (o.l_free)
+      sd_free (o.l);
+   if (o.r_free)
+      sd_free (o.r);
+   return failure;
+}
+
+sd_divisor_t *
+sd_divisor (sd_p p)
+{                               // Precomputed divisor, for dividing many values by p
+   if (!p || !p->n || !p->n->sig || (p->d && !p->d->sig))
+      return NULL;
+   sd_divisor_t *by = calloc (1, sizeof (*by));
+   if (!by)
+      return by;
+   const char *failure = NULL;
+   by->b = copy (&failure, p->n);
+   by->d = copy (&failure, p->d);
+   by->half = uhalf (&failure, p->n);
+   by->top = utop (p->n);
+   by->places = p->places;
+   by->prec = p->prec;
+   by->precden = p->precden;
+   by->precround = p->precround;
+   if (failure)
+      by = sd_divisor_free (by);
+   return by;
+}
+
+void *
+sd_divisor_free (sd_divisor_t * by)
+{                               // Free divisor
+   if (by)
+   {
+      freez (by->b);
+      freez (by->d);
+      freez (by->half);
+      free (by);
+   }
+   return NULL;
+}
+
+sd_p
+sd_div_by_opts (sd_div_by_t o)
+{                               // Divide by precomputed divisor, to places, same as rounding the result of sd_div
+   if (!o.by)
+      return NULL;
+   sd_p p = o.p ? : &sd_zero;
+   sd_p v = sd_new (p, NULL);
+   if (!v)
+      return v;
+   if (o.by->places > v->places)
+      v->places = o.by->places;
+   precmerge (&v->prec, &v->precden, &v->precround, o.by->prec, o.by->precden, o.by->precround);
+   if (o.rem)
+      *o.rem = NULL;
+   if (p->d && !p->d->sig)
+   {                            // Infinite, not dividing by its zero denominator
+      v->failure = "Division by zero";
+      if (o.p_free)
+         sd_free (o.p);
+      return v;
+   }
+   int prec = (v->prec || v->precden);
+   sd_val_t *a = p->n,
+      *b = NULL,
+      *rem = NULL;
+   if (o.by->d)
+      a = smul (&v->failure, a, o.by->d);
+   if (p->d)
+      b = smul (&v->failure, p->d, o.by->b);    // Rational, so a different divisor each time
+ v->n = udiv (&v->failure, a, b, by: b ? NULL : o.by, neg: a->neg != o.by->b->neg, rem: o.rem && !prec ? &rem : NULL, places: o.places, round:o.round);
+   if (a != p->n)
+      freez (a);
+   freez (b);
+   v = sd_tidy (v);             // Precision context may round the quotient further
+   if (o.rem && prec)
+   {                            // Remainder from the quotient as rounded, in the same context
+    struct sd_s by = { n: o.by->b, d: o.by->d, places: o.by->places, prec: o.by->prec, precden: o.by->precden, precround:o.by->precround };
+      *o.rem = (v->n ? sd_sub_cf (p, sd_mul (v, &by)) : NULL);
+   } else if (o.rem)
+   {                            // Remainder over the denominators
+      sd_p r = sd_new (v, NULL);
+      if (r)
+      {
+         r->n = rem;
+         if (p->d || o.by->d)
+            r->d = umul (&r->failure, p->d ? : &one, o.by->d ? : &one);
+         r = sd_tidy (r);
+      } else
+         freez (rem);
+      *o.rem = r;
+   }
+   if (o.p_free)
+      sd_free (o.p);
+   return v;
 }
 
-int
-sd_ispos (sd_p p)
-{                               // Is positive (denominator always positive)
-   return p && p->n && p->n->sig && !p->n->neg;
+static int
+upow_digits (sd_val_t * a, unsigned long long e)
+{                               // Upper bound on digits of a^e, taking a as an integer, a^e must fit INT_MAX digits
+   int len = (a->sig < 15 ? a->sig : 15);
+   double m = 0,
+      rm = 1;
+   for (int i = 0; i < len; i++)
+      m = m * 10 + a->d[i];
+   m += 1;                      // Round up
+   long long x = a->sig - len,
+      rx = 0;
+   void decade (double *m, long long *x)
+   {                            // Keep m 1 to 10, decades in x
+      while (*m >= 10)
+      {
+         *m /= 10;
+         (*x)++;
+      }
+   }
+   decade (&m, &x);
+   for (; e; e >>= 1)
+   {
+      if (e & 1)
+      {
+         rm *= m;
+         rx += x;
+         decade (&rm, &rx);
+      }
+      if (e > 1)
+      {
+         m *= m;
+         x *= 2;
+         decade (&m, &x);
+      }
+   }
+   return rx + 2 + rx / 1000000;        // Allow for rounding
 }
 
-static void
-sd_rational (sd_p p)
-{                               // Normalise to integers
-   if (!p || !p->n)
-      return;
-   if (!p->d)
-      p->d = copy (&p->failure, &one);
-   int s,
-     shift = p->n->sig - p->n->mag - 1;
-   if ((s = p->d->sig - p->d->mag - 1) > shift)
-      shift = s;
-   p->n->mag += shift;
-   p->d->mag += shift;
+static sd_val_t *
+upow (const char **failp, sd_val_t * a, unsigned long long e)
+{                               // a^e, a taken as an integer of its digits and position as a shift, sliding window on limbs
+   if (e && (!a->sig || e == 1))
+      return copy (failp, a);
+   int shift = a->mag - a->sig + 1;     // Position of last digit
+   if ((double) a->sig * e > INT_MAX / 2 || (double) shift * e > INT_MAX / 2 || (double) shift * e < INT_MIN / 2)
+   {
+      if (failp && !*failp)
+         *failp = "Power too large";
+      return NULL;
+   }
+   int neg = (a->neg && (e & 1));
+   shift *= (int) e;
+   if (!e || (a->sig == 1 && a->d[0] == 1))
+   {                            // Power of 10, just a shift
+      sd_val_t *r = make (failp, e ? shift : 0, 1);
+      if (r)
+      {
+         r->d[0] = 1;
+         r->neg = neg;
+      }
+      return r;
+   }
+   int digits = upow_digits (a, e);
+   if (checkmax (failp, shift + digits - 1, digits))
+      return NULL;
+   int na = limbs (a->sig),
+      nmax = digits / LIMB_DIGITS + 3,
+      bits = 64 - __builtin_clzll (e),
+      k = (bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : bits > 6 ? 2 : 1);    // Window
+   limb_t *tab[32] = { },       // Odd powers a, a^3, a^5...
+      *r = malloc (nmax * sizeof (*r)),
+      *t = malloc (nmax * sizeof (*t));
+   int ntab[32] = { },
+      nr = 0;
+   sd_val_t *nomem (void)
+   {                            // Free working space, and fail
+      free (r);
+      free (t);
+      for (int j = 0; j < 32; j++)
+         free (tab[j]);
+      if (failp && !*failp)
+         *failp = "Malloc failed";
+      return NULL;
+   }
+   if (!r || !t || !(tab[0] = malloc (na * sizeof (limb_t))))
+      return nomem ();
+   tolimbs (a, a->mag - a->sig, tab[0], ntab[0] = na);
+   void trim (limb_t * l, int *n)
+   {
+      while (*n && !l[*n - 1])
+         (*n)--;
+   }
+   void mul (const limb_t * b, int nb)
+   {                            // r = r * b, squaring if b is r
+      lmul (t, r, nr, b, nb);
+      limb_t *s = r;
+      r = t;
+      t = s;
+      nr += nb;
+      trim (r, &nr);
+   }
+   if (k > 1)
+   {                            // a^2 in r, then odd powers
+      memcpy (r, tab[0], (nr = na) * sizeof (*r));
+      mul (r, nr);
+      for (int j = 1; j < 1 << (k - 1); j++)
+      {
+         if (!(tab[j] = malloc ((ntab[j - 1] + nr) * sizeof (limb_t))))
+            return nomem ();
+         lmul (tab[j], tab[j - 1], ntab[j - 1], r, nr);
+         ntab[j] = ntab[j - 1] + nr;
+         trim (tab[j], &ntab[j]);
+      }
+      nr = 0;
+   }
+   for (int i = bits - 1; i >= 0;)
+   {
+      if (!((e >> i) & 1))
+      {                         // Zero bit, square
+         mul (r, nr);
+         i--;
+         continue;
+      }
+      int l = (i >= k ? i - k + 1 : 0);
+      while (!((e >> l) & 1))
+         l++;                   // Window ends on a one bit
+      int w = (e >> l) & ((1ULL << (i - l + 1)) - 1);
+      if (!nr)
+         memcpy (r, tab[w >> 1], (nr = ntab[w >> 1]) * sizeof (*r));
+      else
+      {
+         for (int j = i; j >= l; j--)
+            mul (r, nr);
+         mul (tab[w >> 1], ntab[w >> 1]);
+      }
+      i = l - 1;
+   }
+   sd_val_t *v = fromlimbs (failp, r, nr, shift - 1);
+   if (v)
+      v->neg = neg;
+   free (r);
+   free (t);
+   for (int j = 0; j < 32; j++)
+      free (tab[j]);
+   return v;
 }
 
 sd_p
-sd_add_opts (sd_2_t o)
-{                               // Add
+sd_pow_opts (sd_2_t o)
+{                               // Positive integer power, exponent as a machine integer, numerator and denominator raised separately
    sd_p l = o.l ? : &sd_zero;
    sd_p r = o.r ? : &sd_zero;
-   sd_debugout ("sd_add", l, r, NULL);
-   sd_val_t *a,
-    *b;
-   sd_p v = sd_cross (l, r, &a, &b);
-   if (v)
+   const char *failp = NULL;
+   if (r->n->neg || (r->d && !r->d->sig))
+      return NULL;              // Not a positive integer, infinite included
+   sd_debugout ("sd_pow", l, r, NULL);
+   sd_val_t *p = NULL;
+   sd_val_t *rem = NULL;
+ p = udiv (&failp, r->n, r->d ? : &one, rem: &rem, round:SD_ROUND_TRUNCATE);
+   if (!rem || rem->sig)
    {
-      v->n = sadd (&v->failure, a ? : l->n, b ? : r->n);
-      if (l->d || r->d)
+      freez (p);
+      freez (rem);
+      return NULL;              // Not integer
+   }
+   freez (rem);
+   if (p->sig > p->mag + 1)
+   {                            // Not integer
+      freez (p);
+      return NULL;
+   }
+   unsigned long long e = 0;
+   int odd = (p->sig && p->sig == p->mag + 1 && (p->d[p->sig - 1] & 1));
+   if (p->mag >= 19)
+      e = ULLONG_MAX;           // Too big, unless base is 0 or 1
+   else
+      for (int i = 0; i <= p->mag; i++)
+         e = e * 10 + (i < p->sig ? p->d[i] : 0);
+   freez (p);
+   if ((l->prec || l->precden) && e > 1 && e != ULLONG_MAX)
+   {                            // Precision context, rounding as we go so nothing gets big
+      sd_p m = sd_copy (l),
+         v = NULL;
+      for (; e; e >>= 1)
       {
-         if (!scmp (&v->failure, l->d ? : &one, r->d ? : &one))
-            v->d = copy (&v->failure, l->d ? : &one);
-         else
-            v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
+         if (e & 1)
+         {
+            if (v)
+               sd_mul_by (&v, m);
+            else
+               v = sd_copy (m);
+         }
+         if (e > 1)
+            sd_mul_by (&m, m);
       }
-      freez (a);
-      freez (b);
+      sd_free (m);
+      if (o.l_free)
+         sd_free (o.l);
+      if (o.r_free)
+         sd_free (o.r);
+      return v;
+   }
+   sd_p v = sd_make (NULL);
+   if (!v)
+      return v;
+   v->prec = l->prec;
+   v->precden = l->precden;
+   v->precround = l->precround;
+   if (e)
+   {
+      v->places = l->places;
+      v->failure = l->failure;
+   }
+   sd_p b = l;
+   if (e > 1 && l->d && l->n->sig)
+   {                            // Lowest terms, so the result is too
+      b = sd_copy (l);
+      sd_reduce (b);
+   }
+   sd_val_t *n = b->n ? : &zero;
+   if (e == ULLONG_MAX && (!n->sig || (!b->d && n->sig == 1 && n->mag == 0 && n->d[0] == 1)))
+   {                            // 0 or 1 or -1 to a huge power
+      v->n = copy (&v->failure, n);
+      if (v->n && v->n->neg && !odd)
+         v->n->neg = 0;
+   } else if (e == ULLONG_MAX)
+      failp = "Power too large";
+   else
+   {
+      v->n = upow (&v->failure, n, e);
+      if (b->d && e)
+         v->d = upow (&v->failure, b->d, e);
    }
-   v = sd_tidy (v);
+   if (b != l)
+      sd_free (b);
+   if (failp && !v->failure)
+      v->failure = failp;
+   v = sd_tidy_reduced (v);
    if (o.l_free)
       sd_free (o.l);
    if (o.r_free)
       sd_free (o.r);
    return v;
-};
+}
 
-sd_p
-sd_sub_opts (sd_2_t o)
-{                               // Subtract
-   sd_p l = o.l ? : &sd_zero;
-   sd_p r = o.r ? : &sd_zero;
-   if (!o.r || !o.r_free)
-   {                            // Copy as we are not freeing
-      o.r = r = sd_copy (r);
-      o.r_free = 1;
-   }
-   if (r && r->n)
-      r->n->neg ^= 1;
-   sd_p v = sd_add (l, r);
-   if (o.l_free)
-      sd_free (o.l);
-   if (o.r_free)
-      sd_free (o.r);
-   return v;
-};
+static sd_val_t *
+uroot (const char **failp, sd_val_t * x, int n)
+{                               // Integer nth root, floor, of non negative integer x, Newton from above with doubling precision
+   if (!x->sig)
+      return copy (failp, &zero);
+   int digits = x->mag + 1;
+   if (digits <= 19)
+   {                            // Fits a word
+      uint64_t v = 0;
+      for (int i = 0; i < digits; i++)
+         v = v * 10 + (i < x->sig ? x->d[i] : 0);
+      uint64_t r = 1ULL << ((64 - __builtin_clzll (v) + n - 1) / n);     // Above the root
+      for (;;)
+      {
+         uint64_t p = 1;
+         for (int i = 1; i < n && p <= v; i++)
+            p = (p > v / r ? v + 1 : p * r);
+         uint64_t next = ((n - 1) * r + v / p) / n;
+         if (next >= r)
+            break;
+         r = next;
+      }
+      return make_int (failp, r);
+   }
+   // Root of the top half of the digits, then Newton from just above at full precision
+   int m = digits / n / 2;
+   if (m < 1)
+      m = 1;
+   sd_val_t *y = copy (failp, x);
+   if (!y)
+      return y;
+   y->mag -= n * m;
+   sd_val_t *t = srnd (failp, y, round:SD_ROUND_TRUNCATE);
+   freez (y);
+   sd_val_t *r = uroot (failp, t, n);
+   freez (t);
+   if (!r)
+      return r;
+   t = uadd (failp, r, &one);
+   freez (r);
+   r = t;
+   if (!r)
+      return r;
+   r->mag += m;
+   sd_val_t *n1 = make_int (failp, n - 1),
+      *nn = make_int (failp, n);
+   while (r)
+   {
+      sd_val_t *p = upow (failp, r, n - 1);
+      sd_val_t *q = udiv (failp, x, p, round: SD_ROUND_TRUNCATE, b_free:1);
+      sd_val_t *t = umul (failp, r, n1);
+      sd_val_t *next = udiv (failp, uadd (failp, t, q), nn, round: SD_ROUND_TRUNCATE, a_free:1);
+      freez (t);
+      freez (q);
+      if (!next || ucmp (failp, next, r, 0) >= 0)
+      {
+         freez (next);
+         break;
+      }
+      freez (r);
+      r = next;
+   }
+   freez (n1);
+   freez (nn);
+   return r;
+}
 
 sd_p
-sd_mul_opts (sd_2_t o)
-{                               // Multiply
-   sd_p v = NULL;
-   if (o.l && o.r)
-   {                            // either being null means answer is null, as null is seen as zero
-      sd_p l = o.l;
-      sd_p r = o.r;
-      sd_debugout ("sd_mul", l, r, NULL);
-      v = sd_new (l, r);
-      if (r->d && !scmp (&v->failure, l->n, r->d))
-      {                         // Cancel out
-         v->n = copy (&v->failure, r->n);
-         v->d = copy (&v->failure, l->d);
-         if (l->n->neg)
-            v->n->neg ^= 1;
-      } else if (l->d && !scmp (&v->failure, r->n, l->d))
-      {                         // Cancel out
-         v->n = copy (&v->failure, l->n);
-         v->d = copy (&v->failure, r->d);
-         if (r->n->neg)
-            v->n->neg ^= 1;
+sd_root_opts (sd_root_t o)
+{                               // nth root, to places, rounded
+   if (!o.p)
+      return NULL;
+   sd_p p = o.p;
+   int n = o.n ? : 2;
+   sd_p v = sd_new (p, NULL);
+   if (!v)
+      return v;
+   v->places = o.places;
+   if (n < 1)
+      v->failure = "Bad root";
+   else if (p->n->neg && !(n & 1))
+      v->failure = "Root of negative";
+   else if (n == 1 || (p->d && !p->d->sig))
+   {                            // Trivial, or infinite
+      v->n = copy (&v->failure, p->n);
+      v->d = copy (&v->failure, p->d);
+   } else
+   {                            // Integer root of value shifted for places+1, then a sticky digit if not exact, then round
+      sd_val_t *x = copy (&v->failure, p->n);
+      if (x)
+      {
+         x->neg = 0;
+         if (x->sig)
+            x->mag += n * (o.places + 1);
+      }
+      sd_val_t *X = NULL;
+      int exact = 1;
+      if (p->d)
+      {
+         sd_val_t *rem = NULL;
+       X = udiv (&v->failure, x, p->d, round: SD_ROUND_TRUNCATE, rem:&rem);
+         exact = (!rem || !rem->sig);
+         freez (rem);
       } else
-      {                         // Multiple
-         if (l->d || r->d)
-            v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
-         v->n = smul (&v->failure, l->n, r->n);
+      {
+         X = srnd (&v->failure, x, round:SD_ROUND_TRUNCATE);
+         exact = (x && x->sig <= x->mag + 1);
+      }
+      freez (x);
+      sd_val_t *r = (X ? uroot (&v->failure, X, n) : NULL);
+      if (r && exact)
+      {
+         sd_val_t *c = upow (&v->failure, r, n);
+         exact = (c && !ucmp (&v->failure, c, X, 0));
+         freez (c);
+      }
+      freez (X);
+      if (r)
+      {
+         if (r->sig)
+            r->mag -= o.places + 1;
+         if (!exact)
+         {
+          sd_val_t *t = uadd (&v->failure, r, &one, boffset:-(o.places + 2));
+            freez (r);
+            r = t;
+         }
+      }
+      if (r)
+      {
+         r->neg = p->n->neg;
+       v->n = srnd (&v->failure, r, places: o.places, round:o.round);
+         freez (r);
       }
-      v = sd_tidy (v);
    }
-   if (o.l_free)
-      sd_free (o.l);
-   if (o.r_free)
-      sd_free (o.r);
-   return v;
-};
+   if (o.p_free)
+      sd_free (o.p);
+   return sd_tidy (v);
+}
 
-sd_p
-sd_div_opts (sd_2_t o)
-{                               // Divide
-   sd_p v = NULL;
-   if (o.l && o.r)
-   {                            // either being null means answer is null, as null is seen as zero
-      sd_p l = o.l;
-      sd_p r = o.r;
-      sd_debugout ("sd_div", l, r, NULL);
-      if (!l->d && !r->d)
-      {                         // Simple - making a new rational
-         v = sd_new (l, r);
-         v->n = copy (&v->failure, l->n);
-         v->d = copy (&v->failure, r->n);
-         v = sd_tidy (v);
+static double
+dln (double x)
+{                               // Natural log of positive double, good enough for estimating sizes
+   if (!(x > 0))
+      return 0;                 // Not positive, callers reject these, but the loops below would never end
+   int e = 0;
+   while (x >= 2)
+   {
+      x /= 2;
+      e++;
+   }
+   while (x < 1)
+   {
+      x *= 2;
+      e--;
+   }
+   double z = (x - 1) / (x + 1),
+      z2 = z * z,
+      s = 0;
+   for (int k = 1; z > 1e-18; k += 2)
+   {
+      s += z / k;
+      z *= z2;
+   }
+   return 2 * s + e * 0.6931471805599453;
+}
+
+static double
+lg (sd_val_t * a)
+{                               // Rough log10 of absolute value, a not zero
+   double v = 0;
+   for (int i = 16; i >= 0; i--)
+      v = v / 10 + (i < a->sig ? a->d[i] : 0);
+   return a->mag + dln (v) / 2.302585092994046;
+}
+
+static double
+approx (sd_val_t * a)
+{                               // Rough value, a small enough for a double
+   double v = 0;
+   for (int i = 0; i < 17 && i < a->sig; i++)
+      v = v * 10 + a->d[i];
+   for (int e = a->mag - (a->sig < 17 ? a->sig : 17) + 1; e > 0; e--)
+      v *= 10;
+   for (int e = a->mag - (a->sig < 17 ? a->sig : 17) + 1; e < 0; e++)
+      v /= 10;
+   return a->neg ? -v : v;
+}
+
+typedef struct
+{                               // Series, sum for n>=0 of 1/b(n) * product p(j)/q(j) for j=0..n
+   sd_val_t *p0;                // p(0)
+   sd_val_t *q0;                // q(0)
+   sd_val_t *p;                 // p(n), n>0
+   sd_val_t *q;                 // q(n), n>0
+   unsigned char qn:1;          // q(n) is q*n, as for exp
+   unsigned char odd:1;         // b(n) is 2n+1, else 1, as for atanh
+   unsigned char alt:1;         // Alternating, as for atan
+} series_t;
+
+static void
+bsplit (const char **failp, series_t * s, int a, int b, sd_val_t ** P, sd_val_t ** Q, sd_val_t ** B, sd_val_t ** T)
+{                               // Binary splitting of terms a to b-1, sum is T/(BQ), NULL B is 1
+   if (b - a == 1)
+   {
+      *P = copy (failp, a ? s->p : s->p0);
+      if (*P && a && s->alt)
+         (*P)->neg ^= 1;
+      if (!a)
+         *Q = copy (failp, s->q0);
+      else if (s->qn)
+      {
+         sd_val_t *n = make_int (failp, a);
+         *Q = umul (failp, s->q, n, b_free:1);
       } else
-      {                         // Flip and multiply 
-         if (!o.r_free)
-         {                      // Copy as we are not freeing
-            o.r = r = sd_copy (r);
-            o.r_free = 1;
-         }
-         sd_val_t *t = r->n;
-         r->n = r->d ? : copy (&v->failure, &one);
-         r->d = t;
-         r->n->neg = r->d->neg;
-         r->d->neg = 0;
-         v = sd_mul (l, r);
+         *Q = copy (failp, s->q);
+      *B = (s->odd && a ? make_int (failp, 2 * a + 1) : NULL);
+      *T = copy (failp, *P);
+      return;
+   }
+   int m = (a + b) / 2;
+   sd_val_t *P1,
+    *Q1,
+    *B1,
+    *T1,
+    *P2,
+    *Q2,
+    *B2,
+    *T2;
+   bsplit (failp, s, a, m, &P1, &Q1, &B1, &T1);
+   bsplit (failp, s, m, b, &P2, &Q2, &B2, &T2);
+   // T = B2 Q2 T1 + B1 P1 T2
+   sd_val_t *l = smul (failp, Q2, T1),
+      *r = smul (failp, P1, T2);
+   if (B2)
+   {
+      sd_val_t *t = smul (failp, B2, l);
+      freez (l);
+      l = t;
+   }
+   if (B1)
+   {
+      sd_val_t *t = smul (failp, B1, r);
+      freez (r);
+      r = t;
+   }
+   *T = sadd (failp, l, r);
+   *P = smul (failp, P1, P2);
+   *Q = smul (failp, Q1, Q2);
+   *B = (B1 && B2 ? smul (failp, B1, B2) : copy (failp, B1 ? : B2));
+   freez (l);
+   freez (r);
+   freez (P1);
+   freez (Q1);
+   freez (B1);
+   freez (T1);
+   freez (P2);
+   freez (Q2);
+   freez (B2);
+   freez (T2);
+}
+
+static sd_val_t *
+series (const char **failp, series_t * s, int terms, int places)
+{                               // Sum of first terms of series, truncated to places
+   sd_val_t *P,
+    *Q,
+    *B,
+    *T;
+   bsplit (failp, s, 0, terms, &P, &Q, &B, &T);
+   if (B)
+      Q = umul (failp, B, Q, b_free:1);
+   sd_val_t *r = sdiv (failp, T, Q, places: places, round: SD_ROUND_TRUNCATE, b_free:1);
+   freez (P);
+   freez (B);
+   freez (T);
+   return r;
+}
+
+static sd_val_t *
+satanh (const char **failp, int u, int v, int alt, int places)
+{                               // atanh(u/v), or atan(u/v) if alt, to places, truncated
+   sd_val_t *U = make_int (failp, u),
+      *V = make_int (failp, v);
+   series_t s = { p0: U, q0: V, p: umul (failp, U, U), q: umul (failp, V, V), odd: 1, alt:alt };
+   sd_val_t *r = series (failp, &s, (places + 2) / (2 * dln ((double) v / u) / 2.302585092994046) + 2, places);
+   freez (U);
+   freez (V);
+   freez (s.p);
+   freez (s.q);
+   return r;
+}
+
+static sd_val_t *
+calc_ln2 (const char **failp, int places)
+{                               // 2 atanh(1/3)
+   sd_val_t *a = satanh (failp, 1, 3, 0, places);
+   sd_val_t *r = sadd (failp, a, a);
+   freez (a);
+   return r;
+}
+
+static sd_val_t *
+calc_ln10 (const char **failp, int places)
+{                               // 3 ln 2 + 2 atanh(1/9)
+   sd_val_t *a = calc_ln2 (failp, places),
+      *b = satanh (failp, 1, 9, 0, places);
+   sd_val_t *t = make_int (failp, 3);
+   a = umul (failp, a, t, a_free: 1, b_free:1);
+   sd_val_t *r = uadd (failp, a, b);
+   freez (a);
+   a = uadd (failp, r, b);
+   freez (r);
+   freez (b);
+   return a;
+}
+
+static sd_val_t *
+calc_pi (const char **failp, int places)
+{                               // 16 atan(1/5) - 4 atan(1/239)
+   sd_val_t *a = satanh (failp, 1, 5, 1, places),
+      *b = satanh (failp, 1, 239, 1, places);
+   sd_val_t *t = make_int (failp, 16);
+   a = umul (failp, a, t, a_free: 1, b_free:1);
+   t = make_int (failp, 4);
+   b = umul (failp, b, t, a_free: 1, b_free:1);
+   sd_val_t *r = ssub (failp, a, b);
+   freez (a);
+   freez (b);
+   return r;
+}
+
+typedef struct
+{                               // Cached constant
+   sd_val_t *v;                 // Value, within 1 in the last place
+   int places;                  // Places held
+} sd_const_cache_t;
+static __thread sd_const_cache_t cache_ln2,
+  cache_ln10,
+  cache_pi;
+
+static sd_val_t *
+constant (const char **failp, sd_const_cache_t * c, sd_val_t * (*calc) (const char **, int), int places)
+{                               // Constant to places, truncated, from cache if held to that many places
+   if (!c->v || c->places < places)
+   {
+      sd_val_t *v = calc (failp, places + 8);
+      if (!v)
+         return v;
+      freez (c->v);
+      sd_arena_t *was = arena;
+      arena = NULL;             // Cache outlives any arena
+    c->v = srnd (failp, v, places: places + 5, round:SD_ROUND_TRUNCATE);
+      arena = was;
+      c->places = places + 5;
+      freez (v);
+   }
+ return srnd (failp, c->v, places: places, round:SD_ROUND_TRUNCATE);
+}
+
+void
+sd_trim (void)
+{                               // Free memory held for this thread, free lists and cached constants
+   sd_const_cache_t *caches[] = { &cache_ln2, &cache_ln10, &cache_pi };
+   for (int i = 0; i < sizeof (caches) / sizeof (*caches); i++)
+   {                            // First, as freeing these puts them on the free lists
+      freez (caches[i]->v);
+      caches[i]->places = 0;
+   }
+   for (int c = 0; c < FREELIST_CLASSES; c++)
+      fltrim (&freeval[c]);
+   fltrim (&freesd);
+}
+
+static sd_val_t *
+sexp (const char **failp, sd_val_t * x, int digits)
+{                               // exp(x) to at least digits significant figures, |x| below 1e9
+   if (!x->sig)
+      return copy (failp, &one);
+   // Halve s times, so the series converges fast, then square s times at the end
+   int s = 8;
+   for (double a = (x->neg ? -approx (x) : approx (x)); a > 0.5; a /= 2)
+      s++;
+   int g = digits + (s * 3 + 9) / 10 + 5,      // Working digits, allowing for squaring
+      w = g + 2;                // Working places of reduced argument, which is well below 1
+   sd_val_t *f = make_int (failp, 5);
+   sd_val_t *y = umul (failp, x, upow (failp, f, s), neg: x->neg, b_free:1);
+   freez (f);
+   if (!y)
+      return y;
+   y->mag -= s;                 // x*5^s/10^s, i.e. x/2^s
+   sd_val_t *r = copy (failp, &one);
+   // Split the reduced argument in to parts of doubling length, each of which is a cheap series as the parts get smaller
+   for (int start = 0, end = 8; r && start < w; start = end, end *= 2)
+   {
+      if (end > w)
+         end = w;
+    sd_val_t *u = srnd (failp, y, places: end, round:SD_ROUND_TRUNCATE);
+    sd_val_t *t = srnd (failp, y, places: start, round:SD_ROUND_TRUNCATE);
+      sd_val_t *p = ssub (failp, u, t);
+      freez (u);
+      freez (t);
+      if (p && p->sig)
+      {                         // exp(p) as sum of (p/q)^n/n! with q=10^end
+         double l = -lg (p),
+            e = 0;
+         int terms = 1;
+         while (e < w + 2)
+            e += l + dln (terms++) / 2.302585092994046;
+         p->mag += end;
+         sd_val_t *q = copy (failp, &one);
+         q->mag += end;
+       series_t S = { p0: &one, q0: &one, p: p, q: q, qn:1 };
+         t = series (failp, &S, terms, w + 2);
+         freez (q);
+         u = smul (failp, r, t);
+         freez (t);
+         freez (r);
+       r = srnd (failp, u, places: w + 2, round: SD_ROUND_TRUNCATE, sig:1);
+         freez (u);
       }
+      freez (p);
    }
-   if (o.l_free)
-      sd_free (o.l);
-   if (o.r_free)
-      sd_free (o.r);
-   return v;
-};
+   freez (y);
+   while (r && s--)
+   {
+      sd_val_t *t = umul (failp, r, r);
+      freez (r);
+    r = srnd (failp, t, places: g, round: SD_ROUND_TRUNCATE, sig:1);
+      freez (t);
+   }
+   return r;
+}
 
-sd_p
-sd_mod_opts (sd_mod_t o)
-{                               // modulo
-   sd_p v = NULL;
-   if (o.l && o.r)
-   {                            // either being null means answer is null, as null is seen as zero
-      sd_p l = o.l;
-      sd_p r = o.r;
-      sd_debugout ("sd_mod", l, r, NULL);
-      v = sd_new (l, r);
-      sd_val_t *ad = smul (&v->failure, l->n, r->d ? : &one);
-      sd_val_t *bc = smul (&v->failure, l->d ? : &one, r->n);
-      v->d = smul (&v->failure, l->d ? : &one, r->d ? : &one);
-    sd_val_t *n = sdiv (&v->failure, ad, bc, rem: &v->n, round:o.round ? : SD_ROUND_FLOOR);
-      freez (ad);
-      freez (bc);
-      freez (n);
-      v = sd_tidy (v);
+static sd_val_t *
+sln (const char **failp, sd_val_t * n, sd_val_t * d, int places)
+{                               // ln(n/d) to places, truncated, n/d positive
+   int f = places + 5;
+   // n/d = 10^e * 2^k * z, z near 1
+   double l = lg (n) - (d ? lg (d) : 0);
+   int e = (int) l - (l < 0);
+   sd_val_t *m = copy (failp, n);
+   if (!m)
+      return m;
+   m->mag -= e;
+   sd_val_t *a = sdiv (failp, m, d ? : &one, places: 16, round:SD_ROUND_TRUNCATE);
+   double v = approx (a);
+   freez (a);
+   int k = 0;
+   for (; v >= 1.5; v /= 2)
+      k++;
+   for (; v < 0.75; v *= 2)
+      k--;
+   sd_val_t *c = make_int (failp, k > 0 ? 5 : 2);
+   m = umul (failp, m, upow (failp, c, k < 0 ? -k : k), a_free: 1, b_free:1);
+   freez (c);
+   if (m && k > 0)
+      m->mag -= k;              // m*5^k/10^k, i.e. m/2^k
+ sd_val_t *z = sdiv (failp, m, d ? : &one, places: f + 3, round: SD_ROUND_TRUNCATE, a_free:1);
+   // Newton, y += z*exp(-y) - 1, from a double, doubling the places each time
+   double y0 = dln (v);
+   sd_val_t *y = make_int (failp, (long long) (y0 * 1e14 + (y0 < 0 ? -0.5 : 0.5)));
+   if (y && y->sig)
+      y->mag -= 14;
+   int steps[32],
+     n0 = 0;
+   for (int p = f + 2; p > 12 && n0 < 32; p = p / 2 + 2)
+      steps[n0++] = p;
+   while (y && z && n0--)
+   {
+      int p = steps[n0];
+      y->neg ^= 1;
+      sd_val_t *t = sexp (failp, y, p + 2);
+      y->neg ^= 1;
+      sd_val_t *u = smul (failp, z, t);
+      freez (t);
+      t = sadd (failp, y, u);
+      freez (u);
+      freez (y);
+      u = ssub (failp, t, &one);
+      freez (t);
+    y = srnd (failp, u, places: p, round:SD_ROUND_TRUNCATE);
+      freez (u);
    }
-   if (o.l_free)
-      sd_free (o.l);
-   if (o.r_free)
-      sd_free (o.r);
-   return v;
+   freez (z);
+   // Add e ln 10 + k ln 2
+   int digits = 1;
+   for (int x = e; x >= 10 || x <= -10; x /= 10)
+      digits++;
+   if (y && e)
+   {
+      sd_val_t *c = constant (failp, &cache_ln10, calc_ln10, f + digits),
+         *t = make_int (failp, e);
+      sd_val_t *u = smul (failp, t, c);
+      freez (c);
+      freez (t);
+      t = sadd (failp, y, u);
+      freez (u);
+      freez (y);
+      y = t;
+   }
+   if (y && k)
+   {
+      sd_val_t *c = constant (failp, &cache_ln2, calc_ln2, f + 1),
+         *t = make_int (failp, k);
+      sd_val_t *u = smul (failp, t, c);
+      freez (c);
+      freez (t);
+      t = sadd (failp, y, u);
+      freez (u);
+      freez (y);
+      y = t;
+   }
+ sd_val_t *r = srnd (failp, y, places: f, round:SD_ROUND_TRUNCATE);
+   freez (y);
+   return r;
 }
 
+#define	EXP_DIGITS	1000000 // Max digits before the point for e^x
+
 sd_p
-sd_pow_opts (sd_2_t o)
-{
-   sd_p l = o.l ? : &sd_zero;
-   sd_p r = o.r ? : &sd_zero;
-   const char *failp = NULL;
-   if (r->n->neg)
+sd_exp_opts (sd_func_t o)
+{                               // e^x, to places, rounded
+   if (!o.p)
       return NULL;
-   sd_debugout ("sd_pow", l, r, NULL);
-   sd_val_t *p = NULL;
-   sd_val_t *rem = NULL;
- p = udiv (&failp, r->n, r->d ? : &one, rem: &rem, round:SD_ROUND_TRUNCATE);
-   if (rem->sig)
+   sd_p p = o.p;
+   sd_p v = sd_new (p, NULL);
+   if (!v)
+      return v;
+   v->places = o.places;
+   if (p->d && !p->d->sig)
+      v->failure = "Division by zero";
+   sd_val_t *x = NULL;
+   double l = (!v->failure && p->n->sig ? lg (p->n) - (p->d ? lg (p->d) : 0) : -1);
+   if (!v->failure && l < 9.5)
+      x = sdiv (&v->failure, p->n, p->d ? : &one, places: 20, round:SD_ROUND_TRUNCATE);
+   int m = (x ? (int) (approx (x) / 2.302585092994046) : p->n->neg ? -2000000000 : 2000000000);  // Roughly the magnitude of the result
+   freez (x);
+   if (!v->failure && (m > EXP_DIGITS || checkmax (NULL, m, m + 1 + (o.places > 0 ? o.places : 0))))
+      v->failure = "Exp too large"; // Before working out all the digits
+   else if (!v->failure && o.places + m + 2 < 0)
+   {                            // Too small to matter, but not zero, so rounding is right
+      sd_val_t *t = copy (&v->failure, &one);
+      if (t)
+         t->mag = -o.places - 2;
+    v->n = srnd (&v->failure, t, places: o.places, round:o.round);
+      freez (t);
+   } else if (!v->failure)
    {
-      freez (p);
-      freez (rem);
-      return NULL;              // Not integer
+      int digits = o.places + m + 5;
+    x = sdiv (&v->failure, p->n, p->d ? : &one, places: digits - (m < 0 ? m : 0) + 3, round:SD_ROUND_TRUNCATE);
+      sd_val_t *r = (x ? sexp (&v->failure, x, digits) : NULL);
+      freez (x);
+    v->n = srnd (&v->failure, r, places: o.places, round:o.round);
+      freez (r);
    }
-   freez (rem);
-   if (p->sig > p->mag + 1)
-   {                            // Not integer
-      freez (p);
+   if (o.p_free)
+      sd_free (o.p);
+   return sd_tidy (v);
+}
+
+sd_p
+sd_ln_opts (sd_func_t o)
+{                               // Natural log, to places, rounded
+   if (!o.p)
       return NULL;
-   }
-   sd_p m = sd_copy (l);
-   sd_p v = sd_int (1);
-   while (p->sig)
+   sd_p p = o.p;
+   sd_p v = sd_new (p, NULL);
+   if (!v)
+      return v;
+   v->places = o.places;
+   if (p->d && !p->d->sig)
+      v->failure = "Division by zero";
+   else if (!p->n->sig || p->n->neg)
+      v->failure = "Log of non positive";
+   else
    {
-    sd_val_t *p2 = udiv (&failp, p, &two, rem: &rem, round:SD_ROUND_TRUNCATE);
-      freez (p);
-      p = p2;
-      if (rem->sig)
-         v = sd_mul_fc (v, m);
-      freez (rem);
-      if (!p->sig)
-         break;
-      m = sd_mul_fc (m, m);
-      debugout ("pow", p2, NULL);
-      sd_debugout ("pow", m, v, NULL);
+      sd_val_t *r = sln (&v->failure, p->n, p->d, o.places);
+    v->n = srnd (&v->failure, r, places: o.places, round:o.round);
+      freez (r);
    }
-   freez (p);
-   sd_free (m);
-   if (failp && !v->failure)
-      v->failure = failp;
-   v = sd_tidy (v);
-   if (o.l_free)
-      sd_free (o.l);
-   if (o.r_free)
-      sd_free (o.r);
-   return v;
+   if (o.p_free)
+      sd_free (o.p);
+   return sd_tidy (v);
+}
+
+sd_p
+sd_log10_opts (sd_func_t o)
+{                               // Log base 10, to places, rounded, exact for powers of 10
+   if (!o.p)
+      return NULL;
+   sd_p p = o.p;
+   sd_p v = sd_new (p, NULL);
+   if (!v)
+      return v;
+   v->places = o.places;
+   if (p->d && !p->d->sig)
+      v->failure = "Division by zero";
+   else if (!p->n->sig || p->n->neg)
+      v->failure = "Log of non positive";
+   else if (p->n->sig == 1 && p->n->d[0] == 1 && (!p->d || (p->d->sig == 1 && p->d->d[0] == 1)))
+      v->n = make_int (&v->failure, p->n->mag - (p->d ? p->d->mag : 0));
+   else
+   {                            // ln x / ln 10
+      int f = o.places + 5;
+      double l = lg (p->n) - (p->d ? lg (p->d) : 0);
+      for (; l >= 1 || l <= -1; l /= 10)
+         f++;                   // Result has more digits before the point
+      sd_val_t *a = sln (&v->failure, p->n, p->d, f),
+         *b = constant (&v->failure, &cache_ln10, calc_ln10, f);
+      sd_val_t *r = (a && b ? sdiv (&v->failure, a, b, places: o.places + 5, round:SD_ROUND_TRUNCATE) : NULL);
+      freez (a);
+      freez (b);
+    v->n = srnd (&v->failure, r, places: o.places, round:o.round);
+      freez (r);
+   }
+   if (o.p_free)
+      sd_free (o.p);
+   return sd_tidy (v);
+}
+
+sd_p
+sd_pi_opts (sd_const_t o)
+{                               // π, to places, rounded
+   sd_p v = sd_make (NULL);
+   if (!v)
+      return v;
+   v->places = o.places;
+   sd_val_t *r = constant (&v->failure, &cache_pi, calc_pi, o.places + 2);
+ v->n = srnd (&v->failure, r, places: o.places, round:o.round);
+   freez (r);
+   return sd_tidy (v);
 }
 
 int
@@ -2068,17 +5689,24 @@ sd_cmp_opts (sd_cmp_t o)
 {                               // Compare
    sd_p l = o.l ? : &sd_zero;
    sd_p r = o.r ? : &sd_zero;
-   sd_val_t *a,
-    *b;
-   sd_p v = sd_cross (l, r, &a, &b);
-   int diff = 0;
-   if (o.abs)
-      diff = ucmp (NULL, a ? : l->n, b ? : r->n, 0);
-   else
-      diff = scmp (NULL, a ? : l->n, b ? : r->n);
-   sd_free (v);
-   freez (a);
-   freez (b);
+   sd_val_t *a = NULL,
+      *b = NULL;
+   sd_p v = NULL;
+   int diff = 2;
+   if (l->d || r->d)
+      diff = cmp_quick (l, r, o.abs);   // Only rationals need cross multiplying, try to avoid it
+   if (diff == 2)
+   {
+      if (l->d || r->d)
+         v = sd_cross (l, r, &a, &b);
+      if (o.abs)
+         diff = ucmp (NULL, a ? : l->n, b ? : r->n, 0);
+      else
+         diff = scmp (NULL, a ? : l->n, b ? : r->n);
+      sd_free (v);
+      freez (a);
+      freez (b);
+   }
    if (o.l_free)
       sd_free (o.l);
    if (o.r_free)
@@ -2094,7 +5722,15 @@ static void *
 parse_operand (void *context, const char *p, const char **end)
 {                               // Parse an operand, malloc value (or null if error), set end
    stringdecimal_context_t *C = context;
- sd_p v = sd_parse (p, end: end, nocomma: C->nocomma, nofrac: C->nofrac, nosi: C->nosi, noieee:C->noieee);
+   sd_p v = NULL;
+   if (!strncmp (p, "π", strlen ("π")))
+   {                            // π to output places, or 3 if not set
+    v = sd_pi (places: C->places ? : 3, round:C->round);
+      *end = p + strlen ("π");
+   } else
+    v = sd_parse (p, end: end, nocomma: C->nocomma, nofrac: C->nofrac, nosi: C->nosi, noieee:C->noieee);
+   if (v && (C->prec || C->precden))
+      v = sd_prec_i (v, prec: C->prec, precden: C->precden, round:C->precround);
    if (v && v->failure)
    {
       if (!C->fail)
@@ -2105,10 +5741,20 @@ parse_operand (void *context, const char *p, const char **end)
    return v;
 }
 
+static void
+parse_divmod_free (stringdecimal_context_t * C)
+{                               // Forget last divmod
+   C->divl = sd_free (C->divl);
+   C->divr = sd_free (C->divr);
+   C->divq = sd_free (C->divq);
+   C->divrem = sd_free (C->divrem);
+}
+
 static void *
 parse_final (void *context, void *v)
 {                               // Final processing
    stringdecimal_context_t *C = context;
+   parse_divmod_free (C);
    if (C->raw)
       return v;
    sd_p V = v;
@@ -2127,6 +5773,7 @@ static void
 parse_fail (void *context, const char *failure, const char *posn)
 {                               // Reporting an error
    stringdecimal_context_t *C = context;
+   parse_divmod_free (C);
    if (!C->fail)
       C->fail = failure;
    if (!C->posn)
@@ -2140,12 +5787,20 @@ parse_fail (void *context, const char *failure, const char *posn)
 static sd_p
 parse_bin_cmp (sd_p l, sd_p r, int match)
 {
-   sd_val_t *a,
-    *b;
-   sd_p L = l,
-      R = r,
+   sd_val_t *a = NULL,
+      *b = NULL;
+   sd_p v = NULL;
+   int diff = 2;
+   if (l->d || r->d)
+      diff = cmp_quick (l, r, 0);
+   if (diff == 2)
+   {
       v = sd_cross (l, r, &a, &b);
-   int diff = scmp (&v->failure, a ? : L->n, b ? : R->n);
+      diff = scmp (&v->failure, a ? : l->n, b ? : r->n);
+      freez (a);
+      freez (b);
+   } else
+      v = sd_new (l, r);
    if (((match & MATCH_LT) && diff < 0) || ((match & MATCH_GT) && diff > 0) || ((match & MATCH_EQ) && diff == 0)
        || ((match & MATCH_NE) && diff != 0))
       v->n = copy (&v->failure, &one);
@@ -2186,20 +5841,123 @@ parse_div (void *context, void *data, void **a)
    return o;
 }
 
+static int
+parse_divmod_same (sd_p a, sd_p b)
+{                               // Same value and context, so the kept result is the one it would give
+   return a->places == b->places && a->prec == b->prec && a->precden == b->precden && a->precround == b->precround
+      && !sd_cmp (a, b);
+}
+
+static sd_p
+parse_divmod (stringdecimal_context_t * C, sd_p l, sd_p r, int rem)
+{                               // Quotient or remainder, keeping both so a//b and a%b only divide once
+   if (!C->divl || !parse_divmod_same (l, C->divl) || !parse_divmod_same (r, C->divr))
+   {
+      parse_divmod_free (C);
+      const char *failure = sd_divmod (l, r, q: &C->divq, rem:&C->divrem);
+      if (failure && !C->fail)
+         C->fail = failure;
+      if (!C->divq || !C->divrem)
+         return NULL;
+      C->divl = sd_copy (l);
+      C->divr = sd_copy (r);
+   }
+   return sd_copy (rem ? C->divrem : C->divq);
+}
+
 static void *
 parse_mod (void *context, void *data, void **a)
 {
-   stringdecimal_context_t *C = context;
-   sd_p o = sd_mod (a[0], a[1]);
-   if (o && o->failure && !C->fail)
-      C->fail = o->failure;
-   return o;
+   sd_p o = sd_word (a[0], a[1], '%', SD_ROUND_FLOOR);  // Small values as words, cheaper than checking what is kept
+   return o ? : parse_divmod (context, a[0], a[1], 1);
 }
 
 static void *
-parse_mul (void *context, void *data, void **a)
+parse_idiv (void *context, void *data, void **a)
 {
-   return sd_mul (a[0], a[1]);
+   return parse_divmod (context, a[0], a[1], 0);
+}
+
+static void *
+parse_mul (void *context, void *data, void **a)
+{                               // Chain, as a product tree
+   int n = 0;
+   while (a[n])
+      n++;
+   if (n == 2)
+      return sd_mul (a[0], a[1]);
+   return sd_product ((sd_p *) a, n);
+}
+
+static sd_p
+parse_pow_real (stringdecimal_context_t * C, sd_p L, sd_p R)
+{                               // Negative or non integer power, exact for integers, else exp(R ln L) to output places, or 3 more than input if not set
+   if ((L->d && !L->d->sig) || (R->d && !R->d->sig))
+   {
+      C->fail = "Division by zero";
+      return NULL;
+   }
+   if (R->n->neg)
+   {                            // Try as reciprocal of integer power
+      sd_p r = sd_neg (R);
+      sd_p o = sd_pow (L, r);
+      sd_free (r);
+      if (o)
+      {
+         if (!o->n->sig)
+         {
+            sd_free (o);
+            C->fail = "Division by zero";
+            return NULL;
+         }
+         return sd_inv_i (o);
+      }
+   }
+   int places = C->places ? : L->places + 3;
+   if (!L->n->sig)
+   {                            // 0^R
+      if (R->n->neg)
+      {
+         C->fail = "Division by zero";
+         return NULL;
+      }
+      sd_p o = sd_copy (L);
+      o->places = places;
+      return o;
+   }
+   int neg = 0;
+   if (L->n->neg)
+   {                            // Negative base only for odd denominator, sign from numerator
+      sd_p r = sd_copy (R);
+      sd_rational (r);
+      sd_reduce (r);
+      sd_val_t *d = r->d,
+         *n = r->n;
+      if (d->sig - 1 != d->mag || !(d->d[d->sig - 1] & 1))
+      {
+         sd_free (r);
+         C->fail = "Power of negative must have odd denominator";
+         return NULL;
+      }
+      neg = (n->sig - 1 == n->mag && (n->d[n->sig - 1] & 1));
+      sd_free (r);
+   }
+   sd_p l = sd_abs (L);
+   // Estimate the size of the result, to know how many places to work to
+   sd_p a = sd_mul_cf (R, sd_ln (l, places:3));
+   double m = approx (a->n) / (a->d ? approx (a->d) : 1) / 2.302585092994046,
+      r = lg (R->n) - (R->d ? lg (R->d) : 0);
+   sd_free (a);
+   int f = places + 5 + (m > 0 ? m : 0) + (r > 0 ? r : 0);
+   if (m > EXP_DIGITS)
+      f = places;               // Fails anyway
+   a = sd_mul_cf (R, sd_ln_f (l, places:f));
+   sd_p o = sd_exp_f (a, places: places, round:C->round);
+   if (o && neg)
+      o->n->neg ^= 1;
+   if (o && o->failure && !C->fail)
+      C->fail = o->failure;
+   return o;
 }
 
 static void *
@@ -2209,6 +5967,8 @@ parse_pow (void *context, void *data, void **a)
    sd_p L = a[0],
       R = a[1];
    sd_p o = sd_pow (L, R);
+   if (!o)
+      o = parse_pow_real (C, L, R);
    if (!o && !C->fail)
       C->fail = "Power must be positive integer";
    if (o && o->failure && !C->fail)
@@ -2232,6 +5992,54 @@ parse_abs (void *context, void *data, void **a)
    return A;
 }
 
+static sd_p
+parse_root (stringdecimal_context_t * C, sd_p A, int n)
+{                               // Root to output places, or 3 more than input if not set
+ sd_p o = sd_root (A, n, places: C->places ? : A->places + 3, round:C->round);
+   if (o && o->failure && !C->fail)
+      C->fail = o->failure;
+   return o;
+}
+
+static void *
+parse_sqrt (void *context, void *data, void **a)
+{
+   return parse_root (context, *a, 2);
+}
+
+static void *
+parse_cbrt (void *context, void *data, void **a)
+{
+   return parse_root (context, *a, 3);
+}
+
+static sd_p
+parse_func (stringdecimal_context_t * C, sd_p (*f) (sd_func_t), sd_p A)
+{                               // Function to output places, or 3 more than input if not set
+ sd_p o = f ((sd_func_t) { p: A, places: C->places ? : A->places + 3, round:C->round });
+   if (o && o->failure && !C->fail)
+      C->fail = o->failure;
+   return o;
+}
+
+static void *
+parse_exp (void *context, void *data, void **a)
+{
+   return parse_func (context, sd_exp_opts, *a);
+}
+
+static void *
+parse_ln (void *context, void *data, void **a)
+{
+   return parse_func (context, sd_ln_opts, *a);
+}
+
+static void *
+parse_log10 (void *context, void *data, void **a)
+{
+   return parse_func (context, sd_log10_opts, *a);
+}
+
 static void *
 parse_not (void *context, void *data, void **a)
 {
@@ -2322,6 +6130,11 @@ static xparse_op_t parse_unary[] = {
    // Postfix would be 15
  {op: "-", level: 14, func:parse_neg},
  {op: "!", op2: "¬", level: 14, func:parse_not},
+ {op: "√", level: 14, func:parse_sqrt},
+ {op: "∛", level: 14, func:parse_cbrt},
+ {op: "exp", level: 14, func:parse_exp},
+ {op: "ln", level: 14, func:parse_ln},
+ {op: "log", level: 14, func:parse_log10},
    {NULL},
 };
 
@@ -2331,9 +6144,10 @@ static xparse_op_t parse_post[] = {
 
 static xparse_op_t parse_binary[] = {
  {op: "^", level: 14, func:parse_pow},
+ {op: "//", level: 13, func:parse_idiv},
  {op: "/", op2: "÷", level: 13, func:parse_div},
  {op: "%", level: 13, func:parse_mod},
- {op: "*", op2: "×", level: 13, func:parse_mul},
+ {op: "*", op2: "×", level: 13, func: parse_mul, nary:1},
    // % would be 14, we should add that
  {op: "+", level: 12, func:parse_add},
  {op: "⁺", op2: "₊", level: 12, func:parse_add},
@@ -2379,9 +6193,11 @@ xparse_config_t stringdecimal_xparse = {
 char *
 stringdecimal_eval_opts (stringdecimal_unary_t o)
 {
- stringdecimal_context_t context = { places: o.places, format: o.format, round: o.round, nocomma: o.nocomma, comma: o.comma, nofrac: o.nofrac, nosi: o.nosi, noieee: o.noieee, combined:o.combined
+ stringdecimal_context_t context = { places: o.places, format: o.format, round: o.round, nocomma: o.nocomma, comma: o.comma, nofrac: o.nofrac, nosi: o.nosi, noieee: o.noieee, combined: o.combined, prec: o.prec, precden: o.precden, precround:o.precround
    };
+   sd_arena_t *a = sd_arena ();        // Values only live for the evaluation, so one arena for them all
    char *ret = xparse (&stringdecimal_xparse, &context, o.a, NULL);
+   sd_arena_end (a);
    if (!ret || context.fail)
    {
       freez (ret);
@@ -2398,6 +6214,7 @@ stringdecimal_eval_opts (stringdecimal_unary_t o)
 // Test function main build
 #include <sys/types.h>
 #include <unistd.h>
+#include <pthread.h>
 
 char *
 expand (const char *s)
@@ -2453,6 +6270,22 @@ expand (const char *s)
    return out;
 }
 
+static void *
+sumthread (void *o)
+{                               // Work out a sum for --threads, twice, with sd_trim after each
+   char *a = stringdecimal_eval_opts (*(stringdecimal_unary_t *) o);
+   sd_trim ();
+   char *b = stringdecimal_eval_opts (*(stringdecimal_unary_t *) o);
+   sd_trim ();
+   if (!a || !b || strcmp (a, b))
+   {
+      freez (a);
+      a = strdup ("!!Different after sd_trim");
+   }
+   freez (b);
+   return a;
+}
+
 #include <popt.h>
 int
 main (int argc, const char *argv[])
@@ -2472,6 +6305,16 @@ main (int argc, const char *argv[])
    int fails = 0;
    int combined = 0;
    const char *currency = NULL;
+   const char *kernels = NULL;
+   int prec = 0;
+   int precden = 0;
+   const char *precround = "";
+   const char *by = NULL;
+   int acc = 0;
+   int dot = 0;
+   int muladd = 0;
+   int arenas = 0;
+   int threads = 0;
    {                            // POPT
       poptContext optCon;       // context for parsing command-line options
       const struct poptOption optionsTable[] = {
@@ -2488,6 +6331,16 @@ main (int argc, const char *argv[])
          {"comma-char", 'C', POPT_ARG_STRING, &scomma, 0, "Set comma char", "char"},
          {"point-char", 'C', POPT_ARG_STRING, &spoint, 0, "Set point char", "char"},
          {"max", 'm', POPT_ARG_INT, &sd_max, 0, "Max size", "N"},
+         {"prec", 0, POPT_ARG_INT, &prec, 0, "Max significant digits of intermediate results", "N"},
+         {"prec-den", 0, POPT_ARG_INT, &precden, 0, "Max denominator digits of intermediate results", "N"},
+         {"prec-round", 0, POPT_ARG_STRING, &precround, 0, "Rounding for intermediate results", "TUFCRBN"},
+         {"kernels", 0, POPT_ARG_STRING, &kernels, 0, "Arithmetic kernels", "scalar/word/avx2"},
+         {"by", 0, POPT_ARG_STRING, &by, 0, "Divide each sum by this using sd_div_by, showing quotient and remainder", "sum"},
+         {"acc", 0, POPT_ARG_NONE, &acc, 0, "Total the sums in two sd_acc accumulators, alternately, merged"},
+         {"dot", 0, POPT_ARG_NONE, &dot, 0, "Show sd_dot of the first half of the sums with the second half"},
+         {"fma", 0, POPT_ARG_NONE, &muladd, 0, "Show sd_fma of three sums, a*b+c"},
+         {"arena", 0, POPT_ARG_NONE, &arenas, 0, "Work out each sum inside two more nested arenas, ending the outer first"},
+         {"threads", 0, POPT_ARG_INT, &threads, 0, "Also work out each sum in this many threads at once, which must all agree", "N"},
          {"pass", 'P', POPT_ARG_STRING, &pass, 0, "Test pass", "expected"},
          {"fail", 'F', POPT_ARG_STRING, &fail, 0, "Test fail", "expected failure"},
          POPT_AUTOHELP {}
@@ -2510,10 +6363,32 @@ main (int argc, const char *argv[])
          sd_comma = *scomma;
       if (spoint)
          sd_point = *spoint;
-      char *s;
-      while ((s = expand (poptGetArg (optCon))))
+      if (kernels && !sd_kernels (kernels))
+         errx (1, "Unknown kernels %s", kernels);
+      if (arenas && (dot || muladd))
+         errx (1, "--arena would free the values kept for --dot or --fma");
+      if (threads < 0 || threads > 64)
+         errx (1, "--threads is 0 to 64");
+      sd_p value (const char *s)
+      {                         // Exact value of a sum, from its rational output
+       char *r = stringdecimal_eval (s, format: '/', nocomma: nocomma, nofrac: nofrac, nosi: nosi, noieee:noieee);
+         sd_p v = NULL;
+         const char *e = NULL;
+         if (r && *r != '!' && (v = sd_parse (r, end:&e)) && *e == '/')
+            v = sd_div_ff (v, sd_parse (e + 1));
+         freez (r);
+         return v;
+      }
+      sd_divisor_t *divisor = NULL;
+      if (by)
       {
-       char *res = stringdecimal_eval (s, places: places, format: *format, round: *round, comma: comma, nocomma: nocomma, nofrac: nofrac, nosi: nosi, noieee: noieee, combined: combined, currency:currency);
+         sd_p b = value (by);
+         if (!(divisor = sd_divisor (b)))
+            errx (1, "Cannot divide by %s", by);
+         sd_free (b);
+      }
+      void result (const char *s, char *res)
+      {                         // Check or show result, and free it
          if (pass && (!res || *res == '!' || strcmp (res, pass)))
          {
             fails++;
@@ -2532,8 +6407,94 @@ main (int argc, const char *argv[])
                fprintf (stderr, "Failed\n");
          }
          freez (res);
+      }
+      sd_acc_t *accs[2] = { };
+      sd_p *vals = NULL;        // For dot and fma
+      int n = 0;
+      if (acc && (!(accs[0] = sd_acc_new ()) || !(accs[1] = sd_acc_new ())))
+         errx (1, "malloc");
+      char *s;
+      while ((s = expand (poptGetArg (optCon))))
+      {
+         sd_arena_t *outer = (arenas ? sd_arena () : NULL),
+            *inner = (arenas ? sd_arena () : NULL);
+       stringdecimal_unary_t o = { a: s, places: places, format: *format, round: *round, comma: comma, nocomma: nocomma, nofrac: nofrac, nosi: nosi, noieee: noieee, combined: combined, currency: currency, prec: prec, precden: precden, precround:*precround };
+         char *res = stringdecimal_eval_opts (o);
+         if (threads)
+         {                      // Same sum in threads at once, each with its own free lists and caches
+            pthread_t t[threads];
+            int started = 0;
+            while (started < threads && !pthread_create (&t[started], NULL, sumthread, &o))
+               started++;
+            for (int i = 0; i < started; i++)
+            {
+               char *r = NULL;
+               pthread_join (t[i], (void **) &r);
+               if (res && (!r || strcmp (r, res)))
+               {
+                  freez (res);
+                  res = strdup ("!!Different in threads");
+               }
+               freez (r);
+            }
+         }
+         if (divisor && res && *res != '!')
+         {                      // Quotient and remainder from the precomputed divisor
+            freez (res);
+            sd_p rem = NULL;
+          sd_p q = sd_div_by_f (divisor, value (s), places: places, round: *round, rem:&rem);
+          char *qs = sd_output (q, places: places, format: *format, round:*round);
+          char *rs = sd_output (rem, format:'/');
+            if (!qs || *qs == '!')
+            {                   // Failed, just the failure
+               res = qs;
+               qs = NULL;
+            } else if (asprintf (&res, "%s %s", qs, rs) < 0)
+               errx (1, "malloc");
+            freez (qs);
+            freez (rs);
+            sd_free (q);
+            sd_free (rem);
+         }
+         if ((acc || dot || muladd) && res && *res != '!')
+         {                      // Total, shown at the end
+            sd_p v = value (s);
+            if (prec || precden)
+               v = sd_prec_i (v, prec: prec, precden: precden, round:*precround);
+            if (acc)
+               sd_acc_add_f (accs[n++ & 1], v);
+            else if (!(vals = realloc (vals, (n + 1) * sizeof (*vals))))
+               errx (1, "malloc");
+            else
+               vals[n++] = v;
+            freez (res);
+         } else
+            result (s, res);
+         sd_arena_end (outer);  // Not innermost
+         sd_arena_end (inner);
          free (s);
       }
+      if (acc)
+      {
+         sd_acc_merge (accs[0], accs[1]);
+         sd_p t = sd_acc_get (accs[0]);
+       result ("[acc]", sd_output (t, places: places, format: *format, round:*round));
+         sd_free (t);
+         sd_acc_free (accs[0]);
+         sd_acc_free (accs[1]);
+      }
+      if (dot || muladd)
+      {
+         if (muladd && n != 3)
+            errx (1, "--fma needs three sums");
+         sd_p t = (muladd ? sd_fma (vals[0], vals[1], vals[2]) : sd_dot (vals, vals + n / 2, n / 2));
+       result (muladd ? "[fma]" : "[dot]", sd_output (t, places: places, format: *format, round:*round));
+         sd_free (t);
+         while (n--)
+            sd_free (vals[n]);
+         free (vals);
+      }
+      sd_divisor_free (divisor);
       poptFreeContext (optCon);
    }
    return fails;
@@ -36,6 +36,7 @@
 extern char sd_comma;           // Comma thousands character
 extern char sd_point;           // Decimal point character
 extern int sd_max;              // Max internal variable, characters as printed excluding comma/sign
+const char *sd_kernels (const char *name);      // Select arithmetic kernels by name (NULL for best for this CPU), returns name in use, NULL if not usable, process wide so call before starting threads
 
 // Rounding options
 
@@ -99,6 +100,9 @@ typedef struct
    unsigned char noieee:1;      // No IEEE suffix when parsing
    unsigned char combined:1;    // Use combined digit and comma or dot
    const char **failure;        // Error string
+   int prec;                    // Precision context, max significant digits of intermediate results (0 for exact)
+   int precden;                 // Precision context, max denominator digits before making decimal (0 for same as prec)
+   sd_round_t precround;        // Precision context, rounding
 } stringdecimal_unary_t;
 typedef struct
 {                               // Division stringdecimal operation
@@ -187,6 +191,11 @@ sd_p sd_copy (sd_p p);          // Make copy
 sd_p sd_int (long long);        // Make from integer
 sd_p sd_float (long double);    // Make from float
 
+typedef struct sd_arena_s sd_arena_t;
+sd_arena_t *sd_arena (void);    // New arena, installed for this thread, small values are then allocated from it and only freed by sd_arena_end, NULL if no memory
+void *sd_arena_end (sd_arena_t *);      // Free arena and everything allocated from it, putting back any arena installed before, returns NULL, any order but same thread
+void sd_trim (void);            // Free memory cached for this thread, e.g. before the thread ends
+
 sd_p sd_parse_opts (sd_parse_t);
 #define	sd_parse(...)		sd_parse_opts((sd_parse_t){__VA_ARGS__})
 #define	sd_parse_f(...)		sd_parse_opts((sd_parse_t){__VA_ARGS__,a_free:1})
@@ -237,6 +246,16 @@ typedef struct
    unsigned char r_free:1;
 } sd_mod_t;
 typedef struct
+{
+   sd_p l;
+   sd_p r;
+   sd_round_t round;            // Rounding of quotient, default floor
+   sd_p *q;                     // Set to integer quotient if not NULL
+   sd_p *rem;                   // Set to remainder if not NULL
+   unsigned char l_free:1;
+   unsigned char r_free:1;
+} sd_divmod_t;
+typedef struct
 {
    sd_p p;
    int places;
@@ -250,6 +269,19 @@ typedef struct
 #define sd_rnd(...) sd_rnd_opts((sd_rnd_t){__VA_ARGS__})
 #define sd_rnd_f(...) sd_rnd_opts((sd_rnd_t){__VA_ARGS__,p_free:1})
 sd_p sd_rnd_opts (sd_rnd_t o);
+
+typedef struct
+{                               // Precision context, results from operations on p carry this and are rounded when over, operands with different limits giving the tighter (smallest non zero)
+   sd_p p;
+   int prec;                    // Max significant digits, 0 for exact
+   int precden;                 // Max denominator digits before making decimal to prec digits, 0 for same as prec
+   sd_round_t round;            // Rounding
+   unsigned char p_free:1;
+} sd_prec_t;
+#define sd_prec(...) sd_prec_opts((sd_prec_t){__VA_ARGS__})
+#define sd_prec_i(...) sd_prec_opts((sd_prec_t){__VA_ARGS__,p_free:1})
+sd_p sd_prec_opts (sd_prec_t);  // Set precision context (default is exact)
+
 #define sd_neg(...) sd_neg_opts((sd_1_t){__VA_ARGS__})
 #define sd_neg_i(...) sd_neg_opts((sd_1_t){__VA_ARGS__,p_free:1})
 sd_p sd_neg_opts (sd_1_t);      // Negate
@@ -278,6 +310,68 @@ sd_p sd_sub_opts (sd_2_t);      // Subtract
 #define sd_mul_cf(...) sd_mul_opts((sd_2_t){__VA_ARGS__,r_free:1})
 #define sd_mul_ff(...) sd_mul_opts((sd_2_t){__VA_ARGS__,l_free:1,r_free:1})
 sd_p sd_mul_opts (sd_2_t);      // Multiply
+
+typedef struct
+{
+   sd_p *p;                     // Array
+   int n;                       // Count
+   unsigned char p_free:1;      // Free the array entries
+} sd_n_t;
+#define sd_product(...) sd_product_opts((sd_n_t){__VA_ARGS__})
+#define sd_product_f(...) sd_product_opts((sd_n_t){__VA_ARGS__,p_free:1})
+sd_p sd_product_opts (sd_n_t);  // Multiply n values, as a balanced tree
+
+// In place, *acc is updated (made if NULL) reusing its space where possible, x is not freed, returns *acc
+sd_p sd_add_to (sd_p * acc, sd_p x);    // *acc += x
+sd_p sd_sub_from (sd_p * acc, sd_p x);  // *acc -= x
+sd_p sd_mul_by (sd_p * acc, sd_p x);    // *acc *= x
+sd_p sd_neg_in_place (sd_p p);  // Negate p itself, returns p
+sd_p sd_abs_in_place (sd_p p);  // Absolute p itself, returns p
+
+// Accumulator, for summing many values, carries and normalises only when read
+// Values over the same denominator are summed without cross multiplying
+// For several threads, use one accumulator each and sd_acc_merge them, the total being exact so the same in any order
+typedef struct sd_acc_s sd_acc_t;
+typedef struct
+{
+   sd_acc_t *a;
+   sd_p p;
+   sd_p m;                      // Multiplier, adds p*m
+   unsigned char sub:1;         // Subtract
+   unsigned char p_free:1;
+   unsigned char m_free:1;
+} sd_acc_add_t;
+sd_acc_t *sd_acc_new (void);    // Make accumulator, zero, NULL if no memory
+void *sd_acc_free (sd_acc_t *);        // Free accumulator
+#define sd_acc_add(...) sd_acc_add_opts((sd_acc_add_t){__VA_ARGS__})
+#define sd_acc_add_f(...) sd_acc_add_opts((sd_acc_add_t){__VA_ARGS__,p_free:1})
+#define sd_acc_sub(...) sd_acc_add_opts((sd_acc_add_t){__VA_ARGS__,sub:1})
+#define sd_acc_sub_f(...) sd_acc_add_opts((sd_acc_add_t){__VA_ARGS__,sub:1,p_free:1})
+void sd_acc_add_opts (sd_acc_add_t);    // Add (or subtract) p
+void sd_acc_merge (sd_acc_t *, sd_acc_t *);     // Add total of second in to first
+sd_p sd_acc_get (sd_acc_t *);   // Total so far (new sd_p)
+
+typedef struct
+{
+   sd_p a;
+   sd_p b;
+   sd_p c;
+   unsigned char a_free:1;
+   unsigned char b_free:1;
+   unsigned char c_free:1;
+} sd_fma_t;
+#define sd_fma(...) sd_fma_opts((sd_fma_t){__VA_ARGS__})
+#define sd_fma_fff(...) sd_fma_opts((sd_fma_t){__VA_ARGS__,a_free:1,b_free:1,c_free:1})
+sd_p sd_fma_opts (sd_fma_t);    // a*b+c
+typedef struct
+{
+   sd_p *a;
+   sd_p *b;
+   int n;
+} sd_dot_t;
+#define sd_dot(...) sd_dot_opts((sd_dot_t){__VA_ARGS__})
+sd_p sd_dot_opts (sd_dot_t);    // Sum of a[i]*b[i] for n values
+
 #define sd_div(...) sd_div_opts((sd_2_t){__VA_ARGS__})
 #define sd_div_fc(...) sd_div_opts((sd_2_t){__VA_ARGS__,l_free:1})
 #define sd_div_cf(...) sd_div_opts((sd_2_t){__VA_ARGS__,r_free:1})
@@ -288,11 +382,67 @@ sd_p sd_div_opts (sd_2_t);      // Divide
 #define sd_pow_cf(...) sd_pow_opts((sd_2_t){__VA_ARGS__,r_free:1})
 #define sd_pow_ff(...) sd_pow_opts((sd_2_t){__VA_ARGS__,l_free:1,r_free:1})
 sd_p sd_pow_opts (sd_2_t);      // Positive Integer Power
+typedef struct
+{
+   sd_p p;
+   int n;                       // Root, default 2
+   int places;                  // Decimal places of result
+   sd_round_t round;            // Rounding of result
+   unsigned char p_free:1;
+} sd_root_t;
+#define sd_root(...) sd_root_opts((sd_root_t){__VA_ARGS__})
+#define sd_root_f(...) sd_root_opts((sd_root_t){__VA_ARGS__,p_free:1})
+#define sd_sqrt(...) sd_root_opts((sd_root_t){__VA_ARGS__,n:2})
+#define sd_sqrt_f(...) sd_root_opts((sd_root_t){__VA_ARGS__,n:2,p_free:1})
+sd_p sd_root_opts (sd_root_t);  // nth root to places, e.g. sd_sqrt(p, places:10), sd_root(p, 3, places:10)
+typedef struct
+{
+   sd_p p;
+   int places;                  // Decimal places of result
+   sd_round_t round;            // Rounding of result
+   unsigned char p_free:1;
+} sd_func_t;
+#define sd_exp(...) sd_exp_opts((sd_func_t){__VA_ARGS__})
+#define sd_exp_f(...) sd_exp_opts((sd_func_t){__VA_ARGS__,p_free:1})
+sd_p sd_exp_opts (sd_func_t);   // e^p to places
+#define sd_ln(...) sd_ln_opts((sd_func_t){__VA_ARGS__})
+#define sd_ln_f(...) sd_ln_opts((sd_func_t){__VA_ARGS__,p_free:1})
+sd_p sd_ln_opts (sd_func_t);    // Natural log to places
+#define sd_log10(...) sd_log10_opts((sd_func_t){__VA_ARGS__})
+#define sd_log10_f(...) sd_log10_opts((sd_func_t){__VA_ARGS__,p_free:1})
+sd_p sd_log10_opts (sd_func_t); // Log base 10 to places, exact for powers of 10
+typedef struct
+{
+   int places;                  // Decimal places of result
+   sd_round_t round;            // Rounding of result
+} sd_const_t;
+#define sd_pi(...) sd_pi_opts((sd_const_t){__VA_ARGS__})
+sd_p sd_pi_opts (sd_const_t);   // π to places, e.g. sd_pi(places:100)
 #define sd_mod(...) sd_mod_opts((sd_mod_t){__VA_ARGS__})
 #define sd_mod_fc(...) sd_mod_opts((sd_mod_t){__VA_ARGS__,l_free:1})
 #define sd_mod_cf(...) sd_mod_opts((sd_mod_t){__VA_ARGS__,r_free:1})
 #define sd_mod_ff(...) sd_mod_opts((sd_mod_t){__VA_ARGS__,l_free:1,r_free:1})
 sd_p sd_mod_opts (sd_mod_t);    // Modulo
+#define sd_divmod(...) sd_divmod_opts((sd_divmod_t){__VA_ARGS__})
+#define sd_divmod_fc(...) sd_divmod_opts((sd_divmod_t){__VA_ARGS__,l_free:1})
+#define sd_divmod_cf(...) sd_divmod_opts((sd_divmod_t){__VA_ARGS__,r_free:1})
+#define sd_divmod_ff(...) sd_divmod_opts((sd_divmod_t){__VA_ARGS__,l_free:1,r_free:1})
+const char *sd_divmod_opts (sd_divmod_t);       // Quotient and remainder from one division, returns failure or NULL
+typedef struct sd_divisor_s sd_divisor_t;
+sd_divisor_t *sd_divisor (sd_p);        // Precomputed divisor, for many divisions by the same value, NULL if zero, infinite or no memory
+void *sd_divisor_free (sd_divisor_t *); // Free divisor, returns NULL
+typedef struct
+{
+   sd_divisor_t *by;
+   sd_p p;
+   int places;
+   sd_round_t round;
+   sd_p *rem;                   // Set to remainder if not NULL
+   unsigned char p_free:1;
+} sd_div_by_t;
+#define sd_div_by(...) sd_div_by_opts((sd_div_by_t){__VA_ARGS__})
+#define sd_div_by_f(...) sd_div_by_opts((sd_div_by_t){__VA_ARGS__,p_free:1})
+sd_p sd_div_by_opts (sd_div_by_t);      // p divided by precomputed divisor to places, e.g. sd_div_by(by, p, places:2)
 #define sd_cmp(...) sd_cmp_opts((sd_cmp_t){__VA_ARGS__})
 #define sd_cmp_fc(...) sd_cmp_opts((sd_cmp_t){__VA_ARGS__,l_free:1})
 #define sd_cmp_cf(...) sd_cmp_opts((sd_cmp_t){__VA_ARGS__,r_free:1})
@@ -24,6 +24,13 @@ struct stringdecimal_context_s {
    unsigned char nosi:1;        // Do not allow SI suffix in parse
    unsigned char noieee:1;      // Do not allow IEEE suffix in parse
    unsigned char combined:1;    // Use combined digit and comma or dot
+   int prec;                    // Precision context, max significant digits
+   int precden;                 // Precision context, max denominator digits
+   sd_round_t precround;        // Precision context, rounding
+   sd_p divl,                   // Last divmod, so a//b and a%b only divide once, freed at end of parse
+    divr,
+    divq,
+    divrem;
 };
 extern xparse_config_t stringdecimal_xparse;
 #endif
@@ -79,7 +79,7 @@ xparse (xparse_config_t * config, void *context, const char *sum, const char **e
          fail = "Missing args";
          return;
       }
-      if (args > 3)
+      if (args > 3 && !operator[operators].op->nary)
       {
          posn = operator[operators].posn;
          fail = "Cannot handle more than 3 args at present";
@@ -94,9 +94,9 @@ xparse (xparse_config_t * config, void *context, const char *sum, const char **e
          warnx ("Doing (%s) %s (%s) (%s)", opval[operands - 3], operator[operators].op->op, opval[operands - 2],
                 opval[operands - 1]);
 #endif
-      void *a[3] = { };
-      for (int n = 0; n < args; n++)
-         a[n] = operand[operands - args + n];
+      void *a[args < 3 ? 4 : args + 1];
+      for (int n = 0; n < sizeof (a) / sizeof (*a); n++)
+         a[n] = (n < args ? operand[operands - args + n] : NULL);
       void *v = operator[operators].func (context, operator[operators].data, a);
       while (args--)
       {
@@ -121,7 +121,14 @@ xparse (xparse_config_t * config, void *context, const char *sum, const char **e
          args = 0 - args;       // Used for prefix unary ops, don't run stack
       else
          while (!fail && operators && operator[operators - 1].level >= level && operator[operators - 1].args)
+         {
+            if (op->nary && operator[operators - 1].op == op && operator[operators - 1].level == level)
+            {                   // Extend chain
+               operator[operators - 1].args++;
+               return;
+            }
             operate ();         // Clear stack of pending ops
+         }
       if (operators + 1 > operatormax)
          operator = realloc (operator, (operatormax += 10) * sizeof (*operator));
       operator[operators].op = op;
@@ -36,6 +36,7 @@ typedef struct {
    char level;                  // Operator precedence 0-9
    xparse_operate *func;        // Function to do operation
    void *data;                  // Passed to xparse_operate
+   unsigned char nary:1;        // Binary op that takes a whole chain (a op b op c...) as one call, args NULL terminated
 } xparse_op_t;
 
 // This is the top level config